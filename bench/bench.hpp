@@ -0,0 +1,220 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Options shared by all the benchmarks
+    ///
+    ////////////////////////////////////////////////////////////
+    struct Options {
+        std::size_t operations = 1000000;
+        std::size_t repetitions = 5;
+        std::string filter;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Number of allocations done by the process so far
+    ///
+    /// Counted by the replacement of the global operator new.
+    ////////////////////////////////////////////////////////////
+    std::size_t allocationCount();
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Result of a benchmark, written as a line of JSON
+    ///
+    ////////////////////////////////////////////////////////////
+    class Result final {
+    public:
+        explicit Result(const std::string& name) {
+            m_fields.emplace_back("benchmark", quote(name));
+        }
+
+        Result& param(const std::string& key, const std::string& value) {
+            m_fields.emplace_back(key, quote(value));
+            return *this;
+        }
+
+        Result& param(const std::string& key, double value) {
+            return metric(key, value);
+        }
+
+        Result& metric(const std::string& key, double value) {
+            std::ostringstream stream;
+            stream << value;
+            m_fields.emplace_back(key, stream.str());
+            return *this;
+        }
+
+        std::string toJson() const {
+            std::string json = "{";
+            for(std::size_t i = 0; i < m_fields.size(); ++i) {
+                if(i != 0) {
+                    json += ",";
+                }
+                json += quote(m_fields[i].first) + ":" + m_fields[i].second;
+            }
+            return json + "}";
+        }
+
+    private:
+        static std::string quote(const std::string& value) {
+            std::string quoted = "\"";
+            for(const char c : value) {
+                if(c == '"' || c == '\\') {
+                    quoted += '\\';
+                }
+                quoted += c;
+            }
+            return quoted + "\"";
+        }
+
+        std::vector<std::pair<std::string, std::string>> m_fields;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Measures of the repetitions of a benchmark
+    ///
+    /// Every repetition records its duration and its number of
+    /// allocations for a given number of operations.
+    ////////////////////////////////////////////////////////////
+    class Runs final {
+    public:
+        explicit Runs(std::size_t operations)
+            : m_operations(operations) {}
+
+        template<class Function>
+        void measure(Function&& function) {
+            const std::size_t allocations = allocationCount();
+            const auto start = std::chrono::steady_clock::now();
+            function();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            m_allocations.push_back(allocationCount() - allocations);
+            m_seconds.push_back(elapsed.count());
+        }
+
+        // Operations per second of the median run, and allocations per operation
+        Result& fill(Result& result) const {
+            std::vector<double> seconds = m_seconds;
+            std::sort(seconds.begin(), seconds.end());
+            std::vector<std::size_t> allocations = m_allocations;
+            std::sort(allocations.begin(), allocations.end());
+
+            return result
+                .param("operations", static_cast<double>(m_operations))
+                .param("repetitions", static_cast<double>(seconds.size()))
+                .metric("ops_per_sec", m_operations / seconds[seconds.size() / 2])
+                .metric("ops_per_sec_min", m_operations / seconds.back())
+                .metric("ops_per_sec_max", m_operations / seconds.front())
+                .metric("allocs_per_op", static_cast<double>(allocations[allocations.size() / 2]) / m_operations);
+        }
+
+    private:
+        std::size_t m_operations;
+        std::vector<double> m_seconds;
+        std::vector<std::size_t> m_allocations;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Latency samples, reported as percentiles in nanoseconds
+    ///
+    ////////////////////////////////////////////////////////////
+    class Latencies final {
+    public:
+        explicit Latencies(std::size_t count) {
+            m_samples.reserve(count);
+        }
+
+        void add(std::chrono::steady_clock::duration latency) {
+            m_samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        }
+
+        void add(const Latencies& other) {
+            m_samples.insert(m_samples.end(), other.m_samples.begin(), other.m_samples.end());
+        }
+
+        Result& fill(Result& result) {
+            std::sort(m_samples.begin(), m_samples.end());
+            return result
+                .param("samples", static_cast<double>(m_samples.size()))
+                .metric("p50_ns", percentile(0.50))
+                .metric("p90_ns", percentile(0.90))
+                .metric("p99_ns", percentile(0.99))
+                .metric("p999_ns", percentile(0.999))
+                .metric("max_ns", m_samples.empty() ? 0.0 : static_cast<double>(m_samples.back()));
+        }
+
+    private:
+        double percentile(double rank) const {
+            if(m_samples.empty()) {
+                return 0.0;
+            }
+            const auto index = static_cast<std::size_t>(rank * (m_samples.size() - 1));
+            return static_cast<double>(m_samples[index]);
+        }
+
+        std::vector<long long> m_samples;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Writes the results as JSON lines
+    ///
+    ////////////////////////////////////////////////////////////
+    class Reporter final {
+    public:
+        Reporter(std::ostream& output, const Options& options)
+            : m_output(output)
+            , m_options(options) {}
+
+        const Options& options() const {
+            return m_options;
+        }
+
+        bool enabled(const std::string& name) const {
+            return name.find(m_options.filter) != std::string::npos;
+        }
+
+        void report(const Result& result) {
+            m_output << result.toJson() << std::endl;
+        }
+
+    private:
+        std::ostream& m_output;
+        const Options& m_options;
+    };
+
+    void runMessageDispatcherBenchmarks(Reporter& reporter);
+    void runLoggerBenchmarks(Reporter& reporter);
+
+}
@@ -0,0 +1,403 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "bench.hpp"
+
+#include <rsm/log/logger.hpp>
+#include <rsm/log/log_category.hpp>
+#include <rsm/log/file_log_device.hpp>
+#include <rsm/log/buffered_file_log_device.hpp>
+#include <rsm/log/compressed_file_log_device.hpp>
+#include <rsm/log/memory_log_device.hpp>
+#include <rsm/log/stream_log_device.hpp>
+#include <rsm/log/console_log_device.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#define RSM_BENCH_QUIET_STDOUT
+#endif
+
+namespace {
+
+    const std::string logFileName = "rsm_bench.log";
+
+    class NullLogDevice final
+        : public rsm::LogDevice {
+    public:
+        void log(rsm::LogLevel level, const std::string& message) override {
+            m_size.fetch_add(message.size(), std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::size_t> m_size{0};
+    };
+
+#if defined(RSM_BENCH_QUIET_STDOUT)
+    // Sends the standard output to /dev/null while the stream device is measured
+    class QuietStdout final {
+    public:
+        QuietStdout() {
+            std::cout.flush();
+            m_saved = ::dup(STDOUT_FILENO);
+            const int null = ::open("/dev/null", O_WRONLY);
+            ::dup2(null, STDOUT_FILENO);
+            ::close(null);
+        }
+
+        ~QuietStdout() {
+            std::cout.flush();
+            ::dup2(m_saved, STDOUT_FILENO);
+            ::close(m_saved);
+        }
+
+        QuietStdout(const QuietStdout&) = delete;
+        QuietStdout& operator=(const QuietStdout&) = delete;
+
+    private:
+        int m_saved;
+    };
+#endif
+
+    // The devices writing to the terminal are only measured when it can be silenced
+    std::vector<const char*> deviceNames() {
+        std::vector<const char*> names = { "null", "file", "buffered_file", "compressed_file", "memory" };
+#if defined(RSM_BENCH_QUIET_STDOUT)
+        names.push_back("stream");
+        names.push_back("console");
+        names.push_back("console_batched");
+#endif
+        return names;
+    }
+
+    rsm::LogDevice::Ptr makeDevice(const std::string& device) {
+        if(device == "file") {
+            return std::make_unique<rsm::FileLogDevice>(logFileName);
+        }
+        if(device == "buffered_file") {
+            return std::make_unique<rsm::BufferedFileLogDevice>(logFileName);
+        }
+        if(device == "buffered_file_sync") {
+            rsm::LogFlushPolicy policy;
+            policy.sync = true;
+            return std::make_unique<rsm::BufferedFileLogDevice>(logFileName, policy);
+        }
+        if(device == "compressed_file") {
+            return std::make_unique<rsm::CompressedFileLogDevice>(logFileName);
+        }
+        if(device == "memory") {
+            rsm::MemoryLogPolicy policy;
+            policy.dumpLevel = rsm::LogLevel::None;
+            return std::make_unique<rsm::MemoryLogDevice>(logFileName, policy);
+        }
+        if(device == "stream") {
+            return std::make_unique<rsm::StreamLogDevice>();
+        }
+        if(device == "console") {
+            return std::make_unique<rsm::ConsoleLogDevice>();
+        }
+        if(device == "console_batched") {
+            rsm::ConsoleLogPolicy policy;
+            policy.lineBuffered = false;
+            return std::make_unique<rsm::ConsoleLogDevice>(rsm::ConsoleStream::Stdout, policy);
+        }
+        return std::make_unique<NullLogDevice>();
+    }
+
+    // Devices of the logger, and its background thread, for the duration of a run
+    class LoggerSetup final {
+    public:
+        LoggerSetup(const std::string& device, bool async) {
+#if defined(RSM_BENCH_QUIET_STDOUT)
+            if(device == "stream" || device.compare(0, 7, "console") == 0) {
+                m_quietStdout.reset(new QuietStdout());
+            }
+#endif
+            rsm::Logger::addLogDevice(makeDevice(device));
+            if(async) {
+                rsm::Logger::startAsync();
+            }
+        }
+
+        ~LoggerSetup() {
+            rsm::Logger::stopAsync();
+            rsm::Logger::resetLogDevices();
+            std::remove(logFileName.c_str());
+        }
+
+        LoggerSetup(const LoggerSetup&) = delete;
+        LoggerSetup& operator=(const LoggerSetup&) = delete;
+
+    private:
+#if defined(RSM_BENCH_QUIET_STDOUT)
+        std::unique_ptr<QuietStdout> m_quietStdout;
+#endif
+    };
+
+    const char* modeName(bool async) {
+        return async ? "async" : "sync";
+    }
+
+    // Every thread logs its share of the records, the first run being a warm up
+    bench::Runs threads(const std::string& device, bool async, std::size_t threadCount, std::size_t messageSize, std::size_t records, std::size_t repetitions) {
+        const std::size_t perThread = std::max<std::size_t>(records / threadCount, 1);
+        const std::string message(messageSize, 'x');
+        bench::Runs runs(perThread * threadCount);
+        for(std::size_t repetition = 0; repetition <= repetitions; ++repetition) {
+            const LoggerSetup setup(device, async);
+            const auto run = [&]() {
+                std::vector<std::thread> loggers;
+                for(std::size_t thread = 0; thread < threadCount; ++thread) {
+                    loggers.emplace_back([&message, perThread, thread]() {
+                        for(std::size_t i = 0; i < perThread; ++i) {
+                            rsm::Logger::info() << message << thread * perThread + i;
+                        }
+                    });
+                }
+                for(auto& logger : loggers) {
+                    logger.join();
+                }
+                rsm::Logger::flush();
+            };
+            repetition == 0 ? run() : runs.measure(run);
+        }
+        return runs;
+    }
+
+    // Time spent in each statement by the threads, without the wait for the background thread
+    void latency(const std::string& device, bool async, std::size_t threadCount, std::size_t records, bench::Latencies& latencies) {
+        const std::size_t perThread = std::max<std::size_t>(records / threadCount, 1);
+        std::vector<bench::Latencies> threadLatencies(threadCount, bench::Latencies(perThread));
+        {
+            const LoggerSetup setup(device, async);
+            std::vector<std::thread> loggers;
+            for(std::size_t thread = 0; thread < threadCount; ++thread) {
+                loggers.emplace_back([&threadLatencies, perThread, thread]() {
+                    for(std::size_t i = 0; i < perThread; ++i) {
+                        const auto start = std::chrono::steady_clock::now();
+                        rsm::Logger::info() << "A log line of a typical length, with a value: " << i;
+                        threadLatencies[thread].add(std::chrono::steady_clock::now() - start);
+                    }
+                });
+            }
+            for(auto& logger : loggers) {
+                logger.join();
+            }
+            rsm::Logger::flush();
+        }
+        for(const auto& measured : threadLatencies) {
+            latencies.add(measured);
+        }
+    }
+
+    // Statements below the threshold, which must cost a load and a comparison
+    bench::Runs disabled(const std::string& statement, std::size_t records, std::size_t repetitions) {
+        bench::Runs runs(records);
+        rsm::LogCategory category("bench");
+        category.setLogLevelThreshold(rsm::LogLevel::Warning);
+        rsm::Logger::addLogDevice(std::make_unique<NullLogDevice>());
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::Warning);
+        const std::string message = "A log line of a typical length, with a value: ";
+        for(std::size_t repetition = 0; repetition <= repetitions; ++repetition) {
+            const auto run = [&]() {
+                if(statement == "macro") {
+                    for(std::size_t i = 0; i < records; ++i) {
+                        RSM_LOG_DEBUG << message << i;
+                    }
+                } else if(statement == "category") {
+                    for(std::size_t i = 0; i < records; ++i) {
+                        RSM_LOG_TO(category, rsm::LogLevel::Debug) << message << i;
+                    }
+                } else {
+                    for(std::size_t i = 0; i < records; ++i) {
+                        rsm::Logger::debug() << message << i;
+                    }
+                }
+            };
+            repetition == 0 ? run() : runs.measure(run);
+        }
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::None);
+        rsm::Logger::resetLogDevices();
+        return runs;
+    }
+
+    // Lines written by the device alone, without the logger in front
+    bench::Runs lines(const std::string& device, std::size_t records, std::size_t repetitions) {
+        const std::string message = "A log line of a typical length, with a value: 123456";
+        bench::Runs runs(records);
+        for(std::size_t repetition = 0; repetition <= repetitions; ++repetition) {
+            auto logDevice = makeDevice(device);
+            const auto run = [&]() {
+                for(std::size_t i = 0; i < records; ++i) {
+                    logDevice->log(rsm::LogLevel::Info, message);
+                }
+                logDevice->flush();
+            };
+            repetition == 0 ? run() : runs.measure(run);
+        }
+        std::remove(logFileName.c_str());
+        return runs;
+    }
+
+    template<class T>
+    void put(rsm::detail::LogStream& stream, bool direct, const T& value) {
+        if(direct) {
+            rsm::detail::writeArgument(stream, value);
+        } else {
+            static_cast<std::ostream&>(stream) << value;
+        }
+    }
+
+    // Arguments formatted in the buffer of a record, by operator<< of the stream or directly
+    bench::Runs formatting(const std::string& argument, bool direct, std::size_t records, std::size_t repetitions) {
+        const std::string message = "A log line of a typical length, with a value: ";
+        rsm::detail::LogStream stream;
+        std::size_t size = 0;
+        bench::Runs runs(records);
+        for(std::size_t repetition = 0; repetition <= repetitions; ++repetition) {
+            const auto run = [&]() {
+                for(std::size_t i = 0; i < records; ++i) {
+                    stream.reset();
+                    if(argument == "int") {
+                        put(stream, direct, static_cast<int>(i));
+                    } else if(argument == "uint64") {
+                        put(stream, direct, i * 0x9e3779b97f4a7c15ull);
+                    } else if(argument == "double_short") {
+                        put(stream, direct, static_cast<double>(i) * 0.25);
+                    } else if(argument == "double_long") {
+                        put(stream, direct, 1.0 / static_cast<double>(i + 1));
+                    } else if(argument == "string") {
+                        put(stream, direct, message);
+                    } else if(argument == "pointer") {
+                        put(stream, direct, static_cast<const void*>(&message[i % message.size()]));
+                    } else {
+                        put(stream, direct, message);
+                        put(stream, direct, i);
+                        put(stream, direct, ' ');
+                        put(stream, direct, static_cast<double>(i) * 0.25);
+                    }
+                    size += stream.str().size();
+                }
+            };
+            repetition == 0 ? run() : runs.measure(run);
+        }
+        volatile std::size_t sink = size;
+        (void)sink;
+        return runs;
+    }
+
+}
+
+void bench::runLoggerBenchmarks(Reporter& reporter) {
+    const Options& options = reporter.options();
+
+    if(reporter.enabled("logger.threads")) {
+        for(const char* device : deviceNames()) {
+            for(const bool async : { false, true }) {
+                for(const std::size_t threadCount : { 1, 2, 4, 8, 16, 32 }) {
+                    Result result("logger.threads");
+                    result.param("device", device)
+                          .param("mode", modeName(async))
+                          .param("threads", static_cast<double>(threadCount));
+                    threads(device, async, threadCount, 32, options.operations, options.repetitions).fill(result);
+                    reporter.report(result);
+                }
+            }
+        }
+    }
+
+    if(reporter.enabled("logger.message_size")) {
+        for(const char* device : { "null", "file", "buffered_file" }) {
+            for(const bool async : { false, true }) {
+                for(const std::size_t messageSize : { 16, 256, 4096 }) {
+                    Result result("logger.message_size");
+                    result.param("device", device)
+                          .param("mode", modeName(async))
+                          .param("message_size", static_cast<double>(messageSize));
+                    threads(device, async, 1, messageSize, options.operations, options.repetitions).fill(result);
+                    reporter.report(result);
+                }
+            }
+        }
+    }
+
+    if(reporter.enabled("logger.latency")) {
+        const std::size_t records = std::max<std::size_t>(options.operations / 10, 1);
+        for(const char* device : deviceNames()) {
+            for(const bool async : { false, true }) {
+                for(const std::size_t threadCount : { 1, 4 }) {
+                    Latencies warmUp(records);
+                    latency(device, async, threadCount, records / 10 + 1, warmUp);
+                    Latencies measured(records);
+                    latency(device, async, threadCount, records, measured);
+
+                    Result result("logger.latency");
+                    result.param("device", device)
+                          .param("mode", modeName(async))
+                          .param("threads", static_cast<double>(threadCount));
+                    measured.fill(result);
+                    reporter.report(result);
+                }
+            }
+        }
+    }
+
+    if(reporter.enabled("logger.disabled")) {
+        for(const char* statement : { "macro", "level_function", "category" }) {
+            Result result("logger.disabled");
+            result.param("statement", statement);
+            disabled(statement, options.operations, options.repetitions).fill(result);
+            reporter.report(result);
+        }
+    }
+
+    if(reporter.enabled("logger.file_device")) {
+        for(const char* device : { "file", "buffered_file", "buffered_file_sync", "compressed_file" }) {
+            Result result("logger.file_device");
+            result.param("device", device);
+            lines(device, options.operations, options.repetitions).fill(result);
+            reporter.report(result);
+        }
+    }
+
+    if(reporter.enabled("logger.format")) {
+        for(const char* argument : { "int", "uint64", "double_short", "double_long", "string", "pointer", "record" }) {
+            for(const bool direct : { false, true }) {
+                Result result("logger.format");
+                result.param("argument", argument)
+                      .param("path", direct ? "direct" : "stream");
+                formatting(argument, direct, options.operations, options.repetitions).fill(result);
+                reporter.report(result);
+            }
+        }
+    }
+}
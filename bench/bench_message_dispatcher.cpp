@@ -0,0 +1,256 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "bench.hpp"
+
+#include <rsm/msg/message.hpp>
+#include <rsm/msg/message_handler.hpp>
+#include <rsm/msg/message_dispatcher.hpp>
+#include <rsm/msg/async_message_dispatcher.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    enum class Kind {
+        Sync,
+        Async,
+        AsyncSingleProducer
+    };
+
+    const Kind kinds[] = { Kind::Sync, Kind::Async, Kind::AsyncSingleProducer };
+
+    const char* kindName(Kind kind) {
+        switch(kind) {
+        case Kind::Sync:
+            return "sync";
+        case Kind::Async:
+            return "async";
+        default:
+            return "async_spsc";
+        }
+    }
+
+    const std::string key = "bench";
+
+    class CountingHandler
+        : public rsm::MessageHandler {
+    public:
+        CountingHandler(std::atomic<std::size_t>& count)
+            : m_count(count) {}
+
+        virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+            // Only the dispatching thread writes the counter
+            m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        std::atomic<std::size_t>& m_count;
+    };
+
+    class LatencyHandler
+        : public rsm::MessageHandler {
+    public:
+        LatencyHandler(const std::atomic<std::chrono::steady_clock::rep>& sentAt, bench::Latencies& latencies, std::atomic<std::size_t>& count)
+            : m_sentAt(sentAt)
+            , m_latencies(latencies)
+            , m_count(count) {}
+
+        virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+            const std::chrono::steady_clock::duration sentAt(m_sentAt.load(std::memory_order_acquire));
+            m_latencies.add(std::chrono::steady_clock::now().time_since_epoch() - sentAt);
+            m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        const std::atomic<std::chrono::steady_clock::rep>& m_sentAt;
+        bench::Latencies& m_latencies;
+        std::atomic<std::size_t>& m_count;
+    };
+
+    // Handlers listening to the benchmarked key, and to other keys to grow the handler map
+    struct Handlers {
+        Handlers(std::atomic<std::size_t>& count, std::size_t handlersPerKey, std::size_t otherKeys)
+            : idle(idleCount) {
+            for(std::size_t i = 0; i < handlersPerKey; ++i) {
+                counting.emplace_back(new CountingHandler(count));
+            }
+            for(std::size_t i = 0; i < otherKeys; ++i) {
+                otherKeyNames.push_back("other" + std::to_string(i));
+            }
+        }
+
+        template<class Dispatcher>
+        void registerTo(Dispatcher& dispatcher) {
+            for(auto& handler : counting) {
+                dispatcher.registerHandler(key, *handler);
+            }
+            for(const auto& otherKey : otherKeyNames) {
+                dispatcher.registerHandler(otherKey, idle);
+            }
+        }
+
+        std::atomic<std::size_t> idleCount{0};
+        CountingHandler idle;
+        std::vector<std::unique_ptr<CountingHandler>> counting;
+        std::vector<std::string> otherKeyNames;
+    };
+
+    void waitFor(const std::atomic<std::size_t>& count, std::size_t expected) {
+        while(count.load(std::memory_order_acquire) < expected) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::unique_ptr<rsm::AsyncMessageDispatcher> makeAsync(Kind kind) {
+        if(kind == Kind::AsyncSingleProducer) {
+            return std::make_unique<rsm::AsyncMessageDispatcher>(rsm::AsyncMessageDispatcher::ProducerMode::Single, 4096);
+        }
+        return std::make_unique<rsm::AsyncMessageDispatcher>();
+    }
+
+    // Pushes the messages and waits until every handler saw them, the first run being a warm up
+    bench::Runs throughput(Kind kind, std::size_t messages, std::size_t handlersPerKey, std::size_t otherKeys, std::size_t repetitions) {
+        bench::Runs runs(messages);
+        for(std::size_t repetition = 0; repetition <= repetitions; ++repetition) {
+            std::atomic<std::size_t> count{0};
+            Handlers handlers(count, handlersPerKey, otherKeys);
+
+            if(kind == Kind::Sync) {
+                rsm::MessageDispatcher dispatcher;
+                handlers.registerTo(dispatcher);
+                const auto run = [&]() {
+                    for(std::size_t i = 0; i < messages; ++i) {
+                        dispatcher.pushMessage(key);
+                    }
+                    dispatcher.dispatch();
+                };
+                repetition == 0 ? run() : runs.measure(run);
+            } else {
+                auto dispatcher = makeAsync(kind);
+                handlers.registerTo(*dispatcher);
+                dispatcher->startDispatching();
+                const auto run = [&]() {
+                    for(std::size_t i = 0; i < messages; ++i) {
+                        dispatcher->pushMessage(key);
+                    }
+                    waitFor(count, messages * handlersPerKey);
+                };
+                repetition == 0 ? run() : runs.measure(run);
+                dispatcher->stopDispatching();
+            }
+        }
+        return runs;
+    }
+
+    // Pushes one message at a time and waits for it to be handled
+    void latency(Kind kind, std::size_t messages, bench::Latencies& latencies) {
+        std::atomic<std::chrono::steady_clock::rep> sentAt{0};
+        std::atomic<std::size_t> count{0};
+        LatencyHandler handler(sentAt, latencies, count);
+
+        const auto send = [&](const std::function<void()>& push, std::size_t index) {
+            sentAt.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+            push();
+            waitFor(count, index + 1);
+        };
+
+        if(kind == Kind::Sync) {
+            rsm::MessageDispatcher dispatcher;
+            dispatcher.registerHandler(key, handler);
+            for(std::size_t i = 0; i < messages; ++i) {
+                send([&]() {
+                    dispatcher.pushMessage(key);
+                    dispatcher.dispatch();
+                }, i);
+            }
+        } else {
+            auto dispatcher = makeAsync(kind);
+            dispatcher->registerHandler(key, handler);
+            dispatcher->startDispatching();
+            for(std::size_t i = 0; i < messages; ++i) {
+                send([&]() {
+                    dispatcher->pushMessage(key);
+                }, i);
+            }
+            dispatcher->stopDispatching();
+        }
+    }
+
+}
+
+void bench::runMessageDispatcherBenchmarks(Reporter& reporter) {
+    const Options& options = reporter.options();
+
+    if(reporter.enabled("dispatcher.push_rate")) {
+        for(const Kind kind : kinds) {
+            Result result("dispatcher.push_rate");
+            result.param("dispatcher", kindName(kind));
+            throughput(kind, options.operations, 1, 0, options.repetitions).fill(result);
+            reporter.report(result);
+        }
+    }
+
+    if(reporter.enabled("dispatcher.latency")) {
+        const std::size_t messages = std::max<std::size_t>(options.operations / 100, 1);
+        for(const Kind kind : kinds) {
+            Latencies latencies(messages);
+            latency(kind, messages / 10 + 1, latencies);
+            Latencies measured(messages);
+            latency(kind, messages, measured);
+
+            Result result("dispatcher.latency");
+            result.param("dispatcher", kindName(kind));
+            measured.fill(result);
+            reporter.report(result);
+        }
+    }
+
+    if(reporter.enabled("dispatcher.fan_out")) {
+        for(const Kind kind : kinds) {
+            for(const std::size_t handlers : { 1, 4, 16, 64 }) {
+                Result result("dispatcher.fan_out");
+                result.param("dispatcher", kindName(kind))
+                      .param("handlers", static_cast<double>(handlers));
+                throughput(kind, std::max<std::size_t>(options.operations / handlers, 1), handlers, 0, options.repetitions).fill(result);
+                reporter.report(result);
+            }
+        }
+    }
+
+    if(reporter.enabled("dispatcher.handler_count")) {
+        for(const Kind kind : kinds) {
+            for(const std::size_t otherKeys : { 0, 100, 10000 }) {
+                Result result("dispatcher.handler_count");
+                result.param("dispatcher", kindName(kind))
+                      .param("registered_keys", static_cast<double>(otherKeys + 1));
+                throughput(kind, options.operations, 1, otherKeys, options.repetitions).fill(result);
+                reporter.report(result);
+            }
+        }
+    }
+}
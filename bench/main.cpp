@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "bench.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+namespace {
+
+    std::atomic<std::size_t> allocations{0};
+
+    void* allocate(std::size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if(void* pointer = std::malloc(size == 0 ? 1 : size)) {
+            return pointer;
+        }
+        throw std::bad_alloc();
+    }
+
+    void usage() {
+        std::cerr << "Usage: rsm_bench [--filter name] [--operations count] [--repetitions count] [--output file]\n"
+                  << "Writes one JSON object per line for every benchmark run\n";
+    }
+
+}
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+std::size_t bench::allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+int main(int argc, char** argv) {
+    bench::Options options;
+    std::string outputFile;
+
+    for(int i = 1; i < argc; ++i) {
+        const bool hasValue = i + 1 < argc;
+        if(std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            options.filter = argv[++i];
+        } else if(std::strcmp(argv[i], "--operations") == 0 && hasValue) {
+            options.operations = std::strtoul(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            options.repetitions = std::strtoul(argv[++i], nullptr, 10);
+        } else if(std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            outputFile = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if(options.operations == 0 || options.repetitions == 0) {
+        usage();
+        return 1;
+    }
+
+    std::ofstream file;
+    if(!outputFile.empty()) {
+        file.open(outputFile, std::ios::out | std::ios::trunc);
+        if(!file.is_open()) {
+            std::cerr << "Impossible to open " << outputFile << "\n";
+            return 1;
+        }
+    }
+
+    bench::Reporter reporter(file.is_open() ? static_cast<std::ostream&>(file) : std::cout, options);
+    bench::runMessageDispatcherBenchmarks(reporter);
+    bench::runLoggerBenchmarks(reporter);
+
+    return 0;
+}
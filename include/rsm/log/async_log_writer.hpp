@@ -0,0 +1,279 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device_set.hpp>
+#include <rsm/mpsc_ring_buffer.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Behavior of the asynchronous logger when its queue is full
+    ///
+    ////////////////////////////////////////////////////////////
+    enum class LogOverflowPolicy {
+        Block,
+        Drop
+    };
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Background thread writing the records to the devices
+        ///
+        /// Loggers only copy the record in a lock-free queue. The mutex
+        /// is only taken to wake the background thread when it sleeps.
+        ////////////////////////////////////////////////////////////
+        class AsyncLogWriter final {
+        public:
+            AsyncLogWriter(const LogDeviceSet& devices, std::size_t capacity, LogOverflowPolicy policy, std::atomic<std::size_t>& droppedCount)
+                : m_devices(devices)
+                , m_queue(capacity)
+                , m_policy(policy)
+                , m_droppedCount(droppedCount)
+                , m_running(true)
+                , m_sleeping(false)
+                , m_flushRequests(0)
+                , m_flushesDone(0) {
+                m_thread = std::thread(&AsyncLogWriter::run, this);
+            }
+
+            // Writes the remaining records and flushes the devices
+            ~AsyncLogWriter() {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_running = false;
+                }
+                m_condition.notify_one();
+                m_thread.join();
+            }
+
+            AsyncLogWriter(const AsyncLogWriter&) = delete;
+            AsyncLogWriter& operator=(const AsyncLogWriter&) = delete;
+
+            // Without devices, or when they are empty, the record goes to the devices of the writer
+            void push(const LogDeviceSet* devices, LogLevel level, std::uint64_t timestamp, const LogSourceLocation& location,
+                      const std::string& message) {
+                priv_push(devices, level, timestamp, location, nullptr, message, nullptr);
+            }
+
+            void pushDeferred(const LogDeviceSet* devices, LogLevel level, std::uint64_t timestamp, const LogSourceLocation& location,
+                              const char* format, const std::string& arguments) {
+                priv_push(devices, level, timestamp, location, format, arguments, nullptr);
+            }
+
+            void pushStructured(const LogDeviceSet* devices, LogLevel level, std::uint64_t timestamp, const LogSourceLocation& location,
+                                const std::string& message, const std::string& fields) {
+                priv_push(devices, level, timestamp, location, nullptr, message, &fields);
+            }
+
+            // Waits until the records pushed before the call are written and the devices flushed.
+            // From a device, only flushes the devices: the background thread can not wait for itself
+            void flush() {
+                if(isWriterThread()) {
+                    for(auto& device : *m_devices.load()) {
+                        device->flush();
+                    }
+                    return;
+                }
+                const std::size_t request = m_flushRequests.fetch_add(1) + 1;
+                priv_wake();
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_flushed.wait(lock, [&]() {
+                    return m_flushesDone >= request;
+                });
+            }
+
+            bool isWriterThread() const {
+                return priv_currentWriter() == this;
+            }
+
+            // True on the background thread of any writer, including one being stopped
+            static bool onWriterThread() {
+                return priv_currentWriter() != nullptr;
+            }
+
+        private:
+            struct Record {
+                // Devices of a category, taken when the record is pushed so the category can go away
+                LogDeviceSet::Snapshot devices;
+                LogLevel level = LogLevel::None;
+                std::uint64_t timestamp = 0;
+                // Thread which logged the record
+                std::uint64_t threadId = 0;
+                LogSourceLocation location = { nullptr, 0, nullptr };
+                // With a format, data holds the encoded arguments of a deferred record
+                const char* format = nullptr;
+                std::string data;
+                std::string fields;
+            };
+
+            void priv_push(const LogDeviceSet* devices, LogLevel level, std::uint64_t timestamp, const LogSourceLocation& location,
+                           const char* format, const std::string& data, const std::string* fields) {
+                LogDeviceSet::Snapshot ownDevices;
+                if(devices) {
+                    ownDevices = devices->load();
+                    if(ownDevices->empty()) {
+                        ownDevices.reset();
+                    }
+                }
+                const auto write = [&](Record& record) {
+                    record.devices = std::move(ownDevices);
+                    record.level = level;
+                    record.timestamp = timestamp;
+                    record.threadId = currentThreadId();
+                    record.location = location;
+                    record.format = format;
+                    record.data.assign(data);
+                    if(fields) {
+                        record.fields.assign(*fields);
+                    } else {
+                        record.fields.clear();
+                    }
+                };
+                while(!m_queue.tryPush(write)) {
+                    // A device logging from the background thread would wait for itself
+                    if(m_policy == LogOverflowPolicy::Drop || isWriterThread()) {
+                        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    priv_wake();
+                    std::this_thread::yield();
+                }
+                priv_wake();
+            }
+
+            void run() {
+                priv_currentWriter() = this;
+                for(;;) {
+                    const std::size_t flushRequests = m_flushRequests.load();
+                    const bool running = m_running;
+                    if(!running || flushRequests != m_flushesDone) {
+                        priv_writeUntil(m_queue.pushedCount());
+                        for(auto& device : *m_devices.load()) {
+                            device->flush();
+                        }
+                        {
+                            std::lock_guard<std::mutex> lock(m_mutex);
+                            m_flushesDone = flushRequests;
+                        }
+                        m_flushed.notify_all();
+                        if(!running) {
+                            return;
+                        }
+                        continue;
+                    }
+
+                    if(priv_write() != 0) {
+                        continue;
+                    }
+
+                    for(int spin = 0; spin < 64 && m_queue.empty(); ++spin) {
+                        std::this_thread::yield();
+                    }
+
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_sleeping.store(true);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    m_condition.wait(lock, [this]() {
+                        return !m_queue.empty() || !m_running || m_flushRequests.load() != m_flushesDone;
+                    });
+                    m_sleeping.store(false, std::memory_order_relaxed);
+                }
+            }
+
+            // Takes one snapshot of the devices per batch of records
+            std::size_t priv_write() {
+                const LogDeviceSet::Snapshot devices = m_devices.load();
+                return m_queue.consume([&devices](Record& record) {
+                    const RecordTimestampScope timestamp(record.timestamp);
+                    const RecordThreadIdScope threadId(record.threadId);
+                    const RecordLocationScope location(record.location);
+                    for(auto& device : record.devices ? *record.devices : *devices) {
+                        if(!device->isEnabled(record.level)) {
+                            continue;
+                        }
+                        if(record.format) {
+                            device->logDeferred(record.level, DeferredLogRecord(record.format, record.data.data(), record.data.size()));
+                        } else if(!record.fields.empty()) {
+                            device->logStructured(record.level, record.data, LogFields(record.fields.data(), record.fields.size()));
+                        } else {
+                            device->log(record.level, record.data);
+                        }
+                    }
+                    record.devices.reset();
+                });
+            }
+
+            // Also waits for the producers still writing a record before the position
+            void priv_writeUntil(std::size_t position) {
+                while(m_queue.consumedCount() < position) {
+                    if(priv_write() == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            // Pairs with the fence of the background thread going to sleep:
+            // either it sees the new record, or we see it sleeping
+            void priv_wake() {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(m_sleeping.load(std::memory_order_relaxed)) {
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                    }
+                    m_condition.notify_one();
+                }
+            }
+
+            // Set by the background thread, so that no other thread reads it while it is assigned
+            static const AsyncLogWriter*& priv_currentWriter() {
+                thread_local const AsyncLogWriter* writer = nullptr;
+                return writer;
+            }
+
+        private:
+            const LogDeviceSet& m_devices;
+            MpscRingBuffer<Record> m_queue;
+            LogOverflowPolicy m_policy;
+            std::atomic<std::size_t>& m_droppedCount;
+            std::thread m_thread;
+            std::mutex m_mutex;
+            std::condition_variable m_condition;
+            std::condition_variable m_flushed;
+            std::atomic<bool> m_running;
+            std::atomic<bool> m_sleeping;
+            std::atomic<std::size_t> m_flushRequests;
+            std::size_t m_flushesDone;
+        };
+
+    }
+
+}
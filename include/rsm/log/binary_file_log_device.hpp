@@ -0,0 +1,165 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Layout of the files written by BinaryFileLogDevice
+        ///
+        /// The file starts with the magic header, followed by entries
+        /// starting with a one byte tag:
+        ///     - Format: id (uint32), length (uint32), format string
+        ///     - Deferred: level (uint8), format id (uint32),
+        ///       size (uint32), encoded arguments
+        ///     - Text: level (uint8), length (uint32), message
+        ///
+        /// A format is written once, before the first record using it.
+        /// Integers use the byte order of the machine writing the file.
+        ////////////////////////////////////////////////////////////
+        namespace binary_log {
+
+            constexpr std::size_t MagicSize = 8;
+
+            inline const char* magic() {
+                return "RSMBLOG1";
+            }
+
+            enum class EntryType : char {
+                Format = 'F',
+                Deferred = 'D',
+                Text = 'T'
+            };
+
+            template<class T>
+            void append(std::string& out, const T& value) {
+                out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            }
+
+        }
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log device writing the records to a file in binary form
+    ///
+    /// Deferred records are stored without being formatted: the format
+    /// string once, then only its id and the encoded arguments for every
+    /// record. Use BinaryLogReader or the rsm_log_decode tool to get the
+    /// text back.
+    ////////////////////////////////////////////////////////////
+	class BinaryFileLogDevice final
+		: public LogDevice {
+
+	public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// Creates the file or truncates it if it exists.
+        ///
+        /// \param fileName Path to the log file
+        ///
+        /// \throw std::runtime_error if the file can not be created
+        ////////////////////////////////////////////////////////////
+		BinaryFileLogDevice(const std::string& fileName) {
+			m_file.open(fileName, std::ios::out | std::ios::trunc | std::ios::binary);
+			if(!m_file.is_open()) {
+				throw std::runtime_error("Impossible to create the log file");
+			}
+			m_file.write(detail::binary_log::magic(), detail::binary_log::MagicSize);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes a text record
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        ////////////////////////////////////////////////////////////
+		void log(LogLevel level, const std::string& message) override {
+			using namespace detail::binary_log;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_buffer.clear();
+			m_buffer.push_back(static_cast<char>(EntryType::Text));
+			append(m_buffer, static_cast<std::uint8_t>(level));
+			append(m_buffer, static_cast<std::uint32_t>(message.size()));
+			m_buffer.append(message);
+			m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes a deferred record as is
+        ///
+        /// \param level Log level
+        /// \param record Record to log
+        ////////////////////////////////////////////////////////////
+		void logDeferred(LogLevel level, const DeferredLogRecord& record) override {
+			using namespace detail::binary_log;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_buffer.clear();
+
+			auto format = m_formatIds.find(record.getFormat());
+			if(format == m_formatIds.end()) {
+				const auto id = static_cast<std::uint32_t>(m_formatIds.size());
+				format = m_formatIds.emplace(record.getFormat(), id).first;
+				const std::string text = record.getFormat();
+				m_buffer.push_back(static_cast<char>(EntryType::Format));
+				append(m_buffer, id);
+				append(m_buffer, static_cast<std::uint32_t>(text.size()));
+				m_buffer.append(text);
+			}
+
+			m_buffer.push_back(static_cast<char>(EntryType::Deferred));
+			append(m_buffer, static_cast<std::uint8_t>(level));
+			append(m_buffer, format->second);
+			append(m_buffer, static_cast<std::uint32_t>(record.getArgumentsSize()));
+			m_buffer.append(record.getArguments(), record.getArgumentsSize());
+			m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that flushes the file
+        ///
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_file.flush();
+		}
+
+	private:
+		std::ofstream m_file;
+		std::mutex m_mutex;
+		std::string m_buffer;
+		std::unordered_map<const char*, std::uint32_t> m_formatIds;
+	};
+
+}
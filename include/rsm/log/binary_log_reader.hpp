@@ -0,0 +1,149 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/binary_file_log_device.hpp>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Reads the records of a file written by BinaryFileLogDevice
+    ///
+    /// Deferred records are formatted as they are read.
+    /// rsm::BinaryLogReader reader("log.bin");
+    /// rsm::LogLevel level;
+    /// std::string message;
+    /// while(reader.next(level, message)) {
+    ///     //...
+    /// }
+    ////////////////////////////////////////////////////////////
+    class BinaryLogReader final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// \param fileName Path to the binary log file
+        ///
+        /// \throw std::runtime_error if the file can not be opened or
+        ///        is not a binary log file
+        ////////////////////////////////////////////////////////////
+        BinaryLogReader(const std::string& fileName) {
+            m_file.open(fileName, std::ios::in | std::ios::binary);
+            if(!m_file.is_open()) {
+                throw std::runtime_error("Impossible to open the log file");
+            }
+            char magic[detail::binary_log::MagicSize];
+            if(!m_file.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != detail::binary_log::magic()) {
+                throw std::runtime_error("Not a binary log file");
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Read the next record
+        ///
+        /// A record cut by the end of the file, as left by a crash,
+        /// ends the reading.
+        ///
+        /// \param level Receives the log level of the record
+        /// \param message Receives the text of the record
+        ///
+        /// \return false when there are no more records
+        ///
+        /// \throw std::runtime_error if the file is corrupted
+        ////////////////////////////////////////////////////////////
+        bool next(LogLevel& level, std::string& message) {
+            using detail::binary_log::EntryType;
+            for(;;) {
+                char type;
+                if(!m_file.get(type)) {
+                    return false;
+                }
+
+                switch(static_cast<EntryType>(type)) {
+                case EntryType::Format: {
+                    std::uint32_t id;
+                    std::string format;
+                    if(!priv_read(id) || !priv_readString(format)) {
+                        return false;
+                    }
+                    if(id != m_formats.size()) {
+                        throw std::runtime_error("Corrupted binary log file");
+                    }
+                    m_formats.push_back(std::move(format));
+                    break;
+                }
+                case EntryType::Deferred: {
+                    std::uint8_t rawLevel;
+                    std::uint32_t id;
+                    if(!priv_read(rawLevel) || !priv_read(id) || !priv_readString(m_arguments)) {
+                        return false;
+                    }
+                    if(id >= m_formats.size()) {
+                        throw std::runtime_error("Corrupted binary log file");
+                    }
+                    level = static_cast<LogLevel>(rawLevel);
+                    message.clear();
+                    DeferredLogRecord(m_formats[id].c_str(), m_arguments.data(), m_arguments.size()).formatTo(message);
+                    return true;
+                }
+                case EntryType::Text: {
+                    std::uint8_t rawLevel;
+                    if(!priv_read(rawLevel) || !priv_readString(message)) {
+                        return false;
+                    }
+                    level = static_cast<LogLevel>(rawLevel);
+                    return true;
+                }
+                default:
+                    throw std::runtime_error("Corrupted binary log file");
+                }
+            }
+        }
+
+    private:
+        template<class T>
+        bool priv_read(T& value) {
+            return static_cast<bool>(m_file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+        }
+
+        bool priv_readString(std::string& value) {
+            std::uint32_t length;
+            if(!priv_read(length)) {
+                return false;
+            }
+            value.resize(length);
+            return length == 0 || static_cast<bool>(m_file.read(&value[0], length));
+        }
+
+    private:
+        std::ifstream m_file;
+        std::vector<std::string> m_formats;
+        std::string m_arguments;
+    };
+
+}
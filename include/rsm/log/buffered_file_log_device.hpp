@@ -0,0 +1,198 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <rsm/log/log_file.hpp>
+#include <rsm/log/log_rotation.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief When a BufferedFileLogDevice writes its buffer to the file
+    ///
+    /// The buffer is always written when full, when the device is
+    /// flushed and when it is destroyed.
+    ////////////////////////////////////////////////////////////
+    struct LogFlushPolicy {
+        /// Size of the buffer in bytes
+        std::size_t bufferSize = 64 * 1024;
+        /// Maximum time a record stays in the buffer: a thread of the
+        /// device writes it when no later record did. Zero disables the
+        /// check and the thread.
+        std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+        /// Write the buffer after logging a record of this level or above
+        LogLevel flushLevel = LogLevel::Error;
+        /// Wait for the data to reach the disk after every write (fdatasync)
+        bool sync = false;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log device for logging into files through a large buffer
+    ///
+    /// Records are formatted in a user-space buffer, written with a single
+    /// system call per batch as set by its LogFlushPolicy. Records still
+    /// in the buffer are lost if the process crashes: lower the interval,
+    /// or flush on more levels, to bound that loss.
+    ///
+    /// The file can be rotated by size and by time, checked after writing
+    /// a batch, so rotating costs nothing to the records only buffered.
+    ////////////////////////////////////////////////////////////
+	class BufferedFileLogDevice final
+		: public LogDevice {
+
+	public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// Creates the log file, truncating it if it already exists
+        /// or appending to it.
+        ///
+        /// \param fileName Path to the log file
+        /// \param policy When to write the buffer to the file
+        /// \param mode Truncate or append to an existing file
+        /// \param rotation When to start a new file
+        ///
+        /// \throw std::runtime_error if the file can not be created
+        ////////////////////////////////////////////////////////////
+		BufferedFileLogDevice(const std::string& fileName, const LogFlushPolicy& policy = LogFlushPolicy(),
+		                      LogFileMode mode = LogFileMode::Truncate, const LogRotationPolicy& rotation = LogRotationPolicy())
+			: m_fileName(fileName)
+			, m_policy(policy)
+			, m_rotation(fileName, rotation)
+			, m_lastWrite(std::chrono::steady_clock::now())
+			, m_running(true) {
+			if(!m_file.open(fileName, mode == LogFileMode::Append)) {
+				throw std::runtime_error("Impossible to create the log file");
+			}
+			m_rotation.opened(mode == LogFileMode::Append ? m_file.size() : 0);
+			m_buffer.reserve(m_policy.bufferSize);
+			if(m_policy.interval.count() > 0) {
+				m_thread = std::thread(&BufferedFileLogDevice::priv_run, this);
+			}
+		}
+
+		~BufferedFileLogDevice() {
+			if(m_thread.joinable()) {
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_running = false;
+				}
+				m_condition.notify_one();
+				m_thread.join();
+			}
+			priv_write();
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that log the message into the buffer
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        ////////////////////////////////////////////////////////////
+		void log(LogLevel level, const std::string& message) override {
+			char prefix[LogPrefixFormatter::MaxSize];
+			const std::size_t prefixSize = formatPrefix(prefix, level);
+			const std::size_t size = prefixSize + message.size() + 1;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(m_buffer.size() + size > m_policy.bufferSize) {
+				priv_write();
+			}
+			m_buffer.insert(m_buffer.end(), prefix, prefix + prefixSize);
+			m_buffer.insert(m_buffer.end(), message.begin(), message.end());
+			m_buffer.push_back('\n');
+
+			if(level >= m_policy.flushLevel || m_buffer.size() >= m_policy.bufferSize || priv_intervalElapsed()) {
+				priv_write();
+			}
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes the buffer to the file
+        ///
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			priv_write();
+		}
+
+	private:
+		// Writes the buffer when the interval elapses without a write
+		void priv_run() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while(m_running) {
+				m_condition.wait_until(lock, m_lastWrite + m_policy.interval, [this]() {
+					return !m_running;
+				});
+				if(m_running && priv_intervalElapsed()) {
+					priv_write();
+				}
+			}
+		}
+
+		bool priv_intervalElapsed() const {
+			return m_policy.interval.count() > 0 && std::chrono::steady_clock::now() - m_lastWrite >= m_policy.interval;
+		}
+
+		void priv_write() {
+			if(!m_buffer.empty()) {
+				m_file.write(m_buffer.data(), m_buffer.size());
+				m_rotation.written(m_buffer.size());
+				m_buffer.clear();
+				if(m_policy.sync) {
+					m_file.sync();
+				}
+				if(m_rotation.isDue()) {
+					m_file.close();
+					m_rotation.rotateFiles();
+					m_file.open(m_fileName, false);
+					m_rotation.opened(0);
+				}
+			}
+			if(m_policy.interval.count() > 0) {
+				m_lastWrite = std::chrono::steady_clock::now();
+			}
+		}
+
+	private:
+		std::string m_fileName;
+		LogFlushPolicy m_policy;
+		detail::LogFile m_file;
+		detail::LogRotation m_rotation;
+		std::mutex m_mutex;
+		std::vector<char> m_buffer;
+		std::chrono::steady_clock::time_point m_lastWrite;
+		std::condition_variable m_condition;
+		bool m_running;
+		std::thread m_thread;
+	};
+
+}
@@ -0,0 +1,305 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <rsm/log/log_file.hpp>
+#include <rsm/log/log_rotation.hpp>
+#include <rsm/log/lz4_block.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Layout of the files written by CompressedFileLogDevice
+        ///
+        /// The file starts with the magic header, followed by blocks of
+        /// lines compressed independently, so a reader can start at any
+        /// block:
+        ///     - stored size of the block (uint32), with the high bit set
+        ///       when the block is stored uncompressed
+        ///     - size of the lines of the block (uint32)
+        ///     - checksum of the lines (uint32)
+        ///     - the block, in the LZ4 block format
+        ///
+        /// Integers use the byte order of the machine writing the file.
+        ////////////////////////////////////////////////////////////
+        namespace compressed_log {
+
+            constexpr std::size_t MagicSize = 8;
+            constexpr std::size_t HeaderSize = 12;
+            constexpr std::uint32_t StoredFlag = 0x80000000u;
+
+            inline const char* magic() {
+                return "RSMZLOG1";
+            }
+
+            // FNV-1a
+            inline std::uint32_t checksum(const char* data, std::size_t size) {
+                std::uint32_t hash = 2166136261u;
+                for(std::size_t i = 0; i < size; ++i) {
+                    hash ^= static_cast<unsigned char>(data[i]);
+                    hash *= 16777619u;
+                }
+                return hash;
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Read the headers of the complete blocks of a file
+            ///
+            /// A block cut by a crash, and everything after it, is skipped.
+            ///
+            /// \param file File positioned after the magic header
+            /// \param fileSize Size of the file
+            /// \param f Function called with the offset and the header of
+            ///        each complete block
+            ///
+            /// \return The end of the last complete block
+            ////////////////////////////////////////////////////////////
+            template<typename F>
+            std::uint64_t readBlockHeaders(std::istream& file, std::uint64_t fileSize, F f) {
+                std::uint64_t offset = MagicSize;
+                std::uint32_t header[3];
+                while(file.read(reinterpret_cast<char*>(header), HeaderSize)) {
+                    const std::uint64_t storedSize = header[0] & ~StoredFlag;
+                    if(storedSize > fileSize - offset - HeaderSize) {
+                        break;
+                    }
+                    f(offset, header);
+                    offset += HeaderSize + storedSize;
+                    file.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+                }
+                file.clear();
+                return offset;
+            }
+
+        }
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log device writing the lines to a file in compressed blocks
+    ///
+    /// Logging a record only appends its line to the current block. Full
+    /// blocks are compressed and written by a thread of the device, so the
+    /// loggers never pay for the compression. Blocks are compressed
+    /// independently in the LZ4 block format: CompressedLogReader reads
+    /// them back, from any block.
+    ///
+    /// The block in progress is written when the device is flushed or
+    /// destroyed. The lines of a block still in memory are lost if the
+    /// process crashes.
+    ////////////////////////////////////////////////////////////
+	class CompressedFileLogDevice final
+		: public LogDevice {
+
+	public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// \param fileName Path to the log file
+        /// \param blockSize Size of the lines compressed together. Larger
+        ///        blocks compress better, smaller ones are quicker to seek.
+        /// \param mode Truncate or append to an existing compressed file.
+        ///        A block cut by a crash at the end of the file is
+        ///        removed before appending.
+        ///
+        /// \throw std::runtime_error if the file can not be created, or
+        ///        if it exists but was not written by the device
+        ////////////////////////////////////////////////////////////
+		CompressedFileLogDevice(const std::string& fileName, std::size_t blockSize = 64 * 1024, LogFileMode mode = LogFileMode::Truncate)
+			: m_blockSize(blockSize > 0 ? blockSize : 1)
+			, m_writing(false)
+			, m_running(true) {
+			if(!m_file.open(fileName, mode == LogFileMode::Append)) {
+				throw std::runtime_error("Impossible to create the log file");
+			}
+			if(mode == LogFileMode::Append) {
+				priv_cutTornBlock(fileName);
+			}
+			if(mode == LogFileMode::Truncate || m_file.size() == 0) {
+				m_file.write(detail::compressed_log::magic(), detail::compressed_log::MagicSize);
+			}
+			m_block.reserve(m_blockSize);
+			m_thread = std::thread(&CompressedFileLogDevice::priv_run, this);
+		}
+
+		~CompressedFileLogDevice() {
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				priv_submit();
+				m_running = false;
+			}
+			m_condition.notify_one();
+			m_thread.join();
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that adds the line to the block
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        ////////////////////////////////////////////////////////////
+		void log(LogLevel level, const std::string& message) override {
+			char prefix[LogPrefixFormatter::MaxSize];
+			const std::size_t prefixSize = formatPrefix(prefix, level);
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_block.append(prefix, prefixSize).append(message).push_back('\n');
+			if(m_block.size() >= m_blockSize) {
+				// Waits if the thread falls two blocks behind, bounding the memory
+				m_written.wait(lock, [this]() {
+					return m_pending.size() < MaxPendingBlocks;
+				});
+				priv_submit();
+				lock.unlock();
+				m_condition.notify_one();
+			}
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes the lines logged so far
+        ///
+        /// The block in progress is ended, even if not full.
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			priv_submit();
+			m_condition.notify_one();
+			m_written.wait(lock, [this]() {
+				return m_pending.empty() && !m_writing;
+			});
+		}
+
+	private:
+		static constexpr std::size_t MaxPendingBlocks = 2;
+
+		// New blocks appended after a torn one could not be read back
+		void priv_cutTornBlock(const std::string& fileName) {
+			using namespace detail::compressed_log;
+			const std::uint64_t fileSize = m_file.size();
+			if(fileSize == 0) {
+				return;
+			}
+			// Cut in the magic header, written again by the constructor
+			if(fileSize < MagicSize) {
+				m_file.truncate(0);
+				return;
+			}
+			std::ifstream file(fileName, std::ios::in | std::ios::binary);
+			char fileMagic[MagicSize];
+			if(!file.read(fileMagic, sizeof(fileMagic)) || std::string(fileMagic, sizeof(fileMagic)) != magic()) {
+				throw std::runtime_error("Not a compressed log file");
+			}
+			const std::uint64_t end = readBlockHeaders(file, fileSize, [](std::uint64_t, const std::uint32_t*) {});
+			if(end < fileSize && !m_file.truncate(static_cast<std::size_t>(end))) {
+				throw std::runtime_error("Impossible to remove the torn block of the log file");
+			}
+		}
+
+		// Called with the mutex locked
+		void priv_submit() {
+			if(m_block.empty()) {
+				return;
+			}
+			std::string next;
+			if(!m_freeBlocks.empty()) {
+				next.swap(m_freeBlocks.back());
+				m_freeBlocks.pop_back();
+			}
+			next.clear();
+			next.reserve(m_blockSize);
+			m_pending.emplace_back(std::move(m_block));
+			m_block.swap(next);
+		}
+
+		void priv_run() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			for(;;) {
+				m_condition.wait(lock, [this]() {
+					return !m_pending.empty() || !m_running;
+				});
+				if(m_pending.empty()) {
+					return;
+				}
+				std::string block = std::move(m_pending.front());
+				m_pending.pop_front();
+				m_writing = true;
+				lock.unlock();
+
+				priv_write(block);
+
+				lock.lock();
+				m_writing = false;
+				m_freeBlocks.emplace_back(std::move(block));
+				m_written.notify_all();
+			}
+		}
+
+		void priv_write(const std::string& block) {
+			using namespace detail::compressed_log;
+			m_compressed.resize(HeaderSize + detail::lz4::compressBound(block.size()));
+			char* data = &m_compressed[HeaderSize];
+			std::uint32_t header[3];
+			std::size_t size = m_compressor.compress(block.data(), block.size(), data);
+			header[0] = static_cast<std::uint32_t>(size);
+			if(size >= block.size()) {
+				std::memcpy(data, block.data(), block.size());
+				size = block.size();
+				header[0] = static_cast<std::uint32_t>(size) | StoredFlag;
+			}
+			header[1] = static_cast<std::uint32_t>(block.size());
+			header[2] = checksum(block.data(), block.size());
+			std::memcpy(&m_compressed[0], header, HeaderSize);
+			m_file.write(m_compressed.data(), HeaderSize + size);
+		}
+
+	private:
+		std::size_t m_blockSize;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::condition_variable m_written;
+		std::string m_block;
+		std::deque<std::string> m_pending;
+		std::vector<std::string> m_freeBlocks;
+		bool m_writing;
+		bool m_running;
+		// Only used by the thread of the device
+		detail::Lz4Compressor m_compressor;
+		std::string m_compressed;
+		detail::LogFile m_file;
+		std::thread m_thread;
+	};
+
+}
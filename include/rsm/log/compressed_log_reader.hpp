@@ -0,0 +1,182 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/compressed_file_log_device.hpp>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Reads the lines of a file written by CompressedFileLogDevice
+    ///
+    /// The blocks are indexed when the file is opened, from their
+    /// headers only, so reading can start at any block without
+    /// decompressing the previous ones:
+    /// rsm::CompressedLogReader reader("app.log.lz4");
+    /// reader.seek(reader.getBlockCount() - 1); // Only the last lines
+    /// std::string line;
+    /// while(reader.next(line)) {
+    ///     //...
+    /// }
+    ///
+    /// A block cut by a crash ends the file.
+    ////////////////////////////////////////////////////////////
+    class CompressedLogReader final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// \param fileName Path to the log file
+        ///
+        /// \throw std::runtime_error if the file can not be opened or
+        ///        was not written by CompressedFileLogDevice
+        ////////////////////////////////////////////////////////////
+        CompressedLogReader(const std::string& fileName)
+            : m_nextBlock(0)
+            , m_linePosition(0) {
+            using namespace detail::compressed_log;
+            m_file.open(fileName, std::ios::in | std::ios::binary);
+            if(!m_file.is_open()) {
+                throw std::runtime_error("Impossible to open the log file");
+            }
+            m_file.seekg(0, std::ios::end);
+            const auto fileSize = static_cast<std::uint64_t>(m_file.tellg());
+            m_file.seekg(0, std::ios::beg);
+            char magic[MagicSize];
+            if(!m_file.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != detail::compressed_log::magic()) {
+                throw std::runtime_error("Not a compressed log file");
+            }
+
+            readBlockHeaders(m_file, fileSize, [this](std::uint64_t offset, const std::uint32_t* header) {
+                m_blocks.push_back({ offset, header[0], header[1], header[2] });
+            });
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the number of complete blocks of the file
+        ///
+        /// \return The number of blocks
+        ////////////////////////////////////////////////////////////
+        std::size_t getBlockCount() const {
+            return m_blocks.size();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the position of a block in the file
+        ///
+        /// \param block Index of the block
+        ///
+        /// \return The offset of the header of the block
+        ////////////////////////////////////////////////////////////
+        std::uint64_t getBlockOffset(std::size_t block) const {
+            return m_blocks.at(block).offset;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Continue reading from the first line of a block
+        ///
+        /// \param block Index of the block, getBlockCount() to end the reading
+        ////////////////////////////////////////////////////////////
+        void seek(std::size_t block) {
+            m_nextBlock = block < m_blocks.size() ? block : m_blocks.size();
+            m_lines.clear();
+            m_linePosition = 0;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Decompress the lines of a block
+        ///
+        /// \param block Index of the block
+        /// \param lines Receives the lines of the block, each ended by '\n'
+        ///
+        /// \throw std::runtime_error if the block is corrupted
+        ////////////////////////////////////////////////////////////
+        void readBlock(std::size_t block, std::string& lines) {
+            using namespace detail::compressed_log;
+            const Block& info = m_blocks.at(block);
+            const std::size_t storedSize = info.storedSize & ~StoredFlag;
+            m_compressed.resize(storedSize);
+            m_file.seekg(static_cast<std::streamoff>(info.offset + HeaderSize), std::ios::beg);
+            if(storedSize > 0 && !m_file.read(&m_compressed[0], static_cast<std::streamsize>(storedSize))) {
+                throw std::runtime_error("Corrupted log block");
+            }
+            lines.resize(info.size);
+            if(info.storedSize & StoredFlag) {
+                lines.assign(m_compressed);
+            } else if(!detail::lz4::decompress(m_compressed.data(), m_compressed.size(), &lines[0], lines.size())) {
+                throw std::runtime_error("Corrupted log block");
+            }
+            if(lines.size() != info.size || checksum(lines.data(), lines.size()) != info.checksum) {
+                throw std::runtime_error("Corrupted log block");
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Read the next line
+        ///
+        /// \param line Receives the line, without its end of line
+        ///
+        /// \return false when there are no more lines
+        ///
+        /// \throw std::runtime_error if a block is corrupted
+        ////////////////////////////////////////////////////////////
+        bool next(std::string& line) {
+            while(m_linePosition >= m_lines.size()) {
+                if(m_nextBlock >= m_blocks.size()) {
+                    return false;
+                }
+                readBlock(m_nextBlock++, m_lines);
+                m_linePosition = 0;
+            }
+            std::size_t end = m_lines.find('\n', m_linePosition);
+            if(end == std::string::npos) {
+                end = m_lines.size();
+            }
+            line.assign(m_lines, m_linePosition, end - m_linePosition);
+            m_linePosition = end + 1;
+            return true;
+        }
+
+    private:
+        struct Block {
+            std::uint64_t offset;
+            std::uint32_t storedSize;
+            std::uint32_t size;
+            std::uint32_t checksum;
+        };
+
+    private:
+        std::ifstream m_file;
+        std::vector<Block> m_blocks;
+        std::size_t m_nextBlock;
+        std::string m_lines;
+        std::size_t m_linePosition;
+        std::string m_compressed;
+    };
+
+}
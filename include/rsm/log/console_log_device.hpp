@@ -0,0 +1,224 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/uio.h>
+#include <unistd.h>
+#define RSM_CONSOLE_LOG_WRITEV
+#endif
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Standard stream a ConsoleLogDevice writes to
+    ///
+    ////////////////////////////////////////////////////////////
+    enum class ConsoleStream {
+        Stdout,
+        Stderr
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief When a ConsoleLogDevice writes its records
+    ///
+    ////////////////////////////////////////////////////////////
+    struct ConsoleLogPolicy {
+        /// Write every record as soon as it is logged. Otherwise the
+        /// records are written in batches.
+        bool lineBuffered = true;
+        /// Number of records written together when not line buffered,
+        /// at most 1024
+        std::size_t batchSize = 64;
+        /// Maximum time between two writes when not line buffered,
+        /// checked when logging. Zero disables the check.
+        std::chrono::milliseconds interval = std::chrono::milliseconds(100);
+        /// Write the batch after logging a record of this level or above
+        LogLevel flushLevel = LogLevel::Error;
+        /// Flush std::cout and the C streams before every write, so the
+        /// records stay in order with what the program prints through them
+        bool syncWithStdio = false;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log device writing to the standard output or error
+    ///
+    /// The records are written straight to the file descriptor with
+    /// writev, without going through std::cout: a line buffered record
+    /// is a single system call of its prefix, message and end of line,
+    /// without copying them, and a batch is a single system call for
+    /// all its records.
+    ///
+    /// Other platforms than POSIX write through the C streams.
+    ////////////////////////////////////////////////////////////
+	class ConsoleLogDevice final
+		: public LogDevice {
+
+	public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with the stream to write to
+        ///
+        /// \param stream Standard output or error
+        /// \param policy When to write the records
+        ////////////////////////////////////////////////////////////
+		ConsoleLogDevice(ConsoleStream stream = ConsoleStream::Stdout, const ConsoleLogPolicy& policy = ConsoleLogPolicy())
+			: m_stream(stream)
+			, m_policy(policy)
+			, m_count(0)
+			, m_lastWrite(std::chrono::steady_clock::now()) {
+			if(m_policy.batchSize == 0) {
+				m_policy.batchSize = 1;
+			} else if(m_policy.batchSize > MaxBatchSize) {
+				m_policy.batchSize = MaxBatchSize;
+			}
+			if(!m_policy.lineBuffered) {
+				m_lines.resize(m_policy.batchSize);
+				m_chunks.reserve(m_policy.batchSize);
+			}
+		}
+
+		~ConsoleLogDevice() {
+			priv_write();
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes the message, or adds
+        ///        it to the batch
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        ////////////////////////////////////////////////////////////
+		void log(LogLevel level, const std::string& message) override {
+			char prefix[LogPrefixFormatter::MaxSize];
+			const std::size_t prefixSize = formatPrefix(prefix, level);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(m_policy.lineBuffered) {
+				const Chunk chunks[] = { { prefix, prefixSize }, { message.data(), message.size() }, { "\n", 1 } };
+				priv_writeChunks(chunks, 3);
+				return;
+			}
+
+			std::string& line = m_lines[m_count++];
+			line.assign(prefix, prefixSize).append(message).push_back('\n');
+			if(m_count == m_lines.size() || level >= m_policy.flushLevel || priv_intervalElapsed()) {
+				priv_write();
+			}
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes the batch
+        ///
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			priv_write();
+		}
+
+	private:
+		static constexpr std::size_t MaxBatchSize = 1024;
+
+		struct Chunk {
+			const char* data;
+			std::size_t size;
+		};
+
+		bool priv_intervalElapsed() const {
+			return m_policy.interval.count() > 0 && std::chrono::steady_clock::now() - m_lastWrite >= m_policy.interval;
+		}
+
+		void priv_write() {
+			if(m_count == 0) {
+				return;
+			}
+			m_chunks.clear();
+			for(std::size_t i = 0; i < m_count; ++i) {
+				m_chunks.push_back({ m_lines[i].data(), m_lines[i].size() });
+			}
+			priv_writeChunks(m_chunks.data(), m_chunks.size());
+			m_count = 0;
+			m_lastWrite = std::chrono::steady_clock::now();
+		}
+
+		// Writes everything, retrying after interruptions and partial writes
+		void priv_writeChunks(const Chunk* chunks, std::size_t count) {
+			if(m_policy.syncWithStdio) {
+				(m_stream == ConsoleStream::Stdout ? std::cout : std::cerr).flush();
+				std::fflush(m_stream == ConsoleStream::Stdout ? stdout : stderr);
+			}
+#if defined(RSM_CONSOLE_LOG_WRITEV)
+			const int descriptor = m_stream == ConsoleStream::Stdout ? STDOUT_FILENO : STDERR_FILENO;
+			iovec vectors[MaxBatchSize];
+			for(std::size_t i = 0; i < count; ++i) {
+				vectors[i].iov_base = const_cast<char*>(chunks[i].data);
+				vectors[i].iov_len = chunks[i].size;
+			}
+			iovec* next = vectors;
+			while(count > 0) {
+				const ssize_t written = ::writev(descriptor, next, static_cast<int>(count));
+				if(written < 0) {
+					if(errno == EINTR) {
+						continue;
+					}
+					return;
+				}
+				std::size_t remaining = static_cast<std::size_t>(written);
+				while(count > 0 && remaining >= next->iov_len) {
+					remaining -= next->iov_len;
+					++next;
+					--count;
+				}
+				if(count > 0) {
+					next->iov_base = static_cast<char*>(next->iov_base) + remaining;
+					next->iov_len -= remaining;
+				}
+			}
+#else
+			std::FILE* file = m_stream == ConsoleStream::Stdout ? stdout : stderr;
+			for(std::size_t i = 0; i < count; ++i) {
+				std::fwrite(chunks[i].data, 1, chunks[i].size, file);
+			}
+			std::fflush(file);
+#endif
+		}
+
+	private:
+		ConsoleStream m_stream;
+		ConsoleLogPolicy m_policy;
+		std::mutex m_mutex;
+		std::vector<std::string> m_lines;
+		std::vector<Chunk> m_chunks;
+		std::size_t m_count;
+		std::chrono::steady_clock::time_point m_lastWrite;
+	};
+
+}
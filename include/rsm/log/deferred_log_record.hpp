@@ -0,0 +1,327 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_format.hpp>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Type tag written before every argument of a deferred record
+        ///
+        ////////////////////////////////////////////////////////////
+        enum class ArgumentType : char {
+            Int = 'i',
+            UInt = 'u',
+            Float = 'f',
+            Double = 'd',
+            Bool = 'b',
+            Char = 'c',
+            String = 's'
+        };
+
+        template<class T>
+        void appendRaw(std::string& out, ArgumentType type, const T& value) {
+            out.push_back(static_cast<char>(type));
+            out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        inline void appendString(std::string& out, const char* data, std::size_t size) {
+            const auto length = static_cast<std::uint32_t>(size);
+            appendRaw(out, ArgumentType::String, length);
+            out.append(data, length);
+        }
+
+        inline void encodeArgument(std::string& out, bool value) {
+            appendRaw(out, ArgumentType::Bool, static_cast<char>(value));
+        }
+
+        inline void encodeArgument(std::string& out, char value) {
+            appendRaw(out, ArgumentType::Char, value);
+        }
+
+        // Written as characters like the streams do, not as std::int8_t numbers
+        inline void encodeArgument(std::string& out, signed char value) {
+            appendRaw(out, ArgumentType::Char, static_cast<char>(value));
+        }
+
+        inline void encodeArgument(std::string& out, unsigned char value) {
+            appendRaw(out, ArgumentType::Char, static_cast<char>(value));
+        }
+
+        template<class T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+        encodeArgument(std::string& out, T value) {
+            appendRaw(out, ArgumentType::Int, static_cast<std::int64_t>(value));
+        }
+
+        template<class T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+        encodeArgument(std::string& out, T value) {
+            appendRaw(out, ArgumentType::UInt, static_cast<std::uint64_t>(value));
+        }
+
+        // Floats keep their type, to be written as a text reading back as the float
+        inline void encodeArgument(std::string& out, float value) {
+            appendRaw(out, ArgumentType::Float, value);
+        }
+
+        template<class T>
+        typename std::enable_if<std::is_floating_point<T>::value && !std::is_same<T, float>::value>::type
+        encodeArgument(std::string& out, T value) {
+            appendRaw(out, ArgumentType::Double, static_cast<double>(value));
+        }
+
+        inline void encodeArgument(std::string& out, const char* value) {
+            if(!value) {
+                value = "(null)";
+            }
+            appendString(out, value, std::strlen(value));
+        }
+
+        inline void encodeArgument(std::string& out, const std::string& value) {
+            appendString(out, value.data(), value.size());
+        }
+
+        // Other types are formatted right away with their operator<<
+        template<class T>
+        typename std::enable_if<!std::is_arithmetic<T>::value && !std::is_convertible<const T&, const char*>::value>::type
+        encodeArgument(std::string& out, const T& value) {
+            std::ostringstream stream;
+            stream << value;
+            encodeArgument(out, stream.str());
+        }
+
+        inline void encodeArguments(std::string&) {
+        }
+
+        template<class T, class... Args>
+        void encodeArguments(std::string& out, const T& value, const Args&... args) {
+            encodeArgument(out, value);
+            encodeArguments(out, args...);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Decoded argument, pointing in the encoded bytes for strings
+        ///
+        ////////////////////////////////////////////////////////////
+        struct ArgumentView {
+            ArgumentType type = ArgumentType::Int;
+            std::int64_t intValue = 0;
+            std::uint64_t uintValue = 0;
+            float floatValue = 0.0f;
+            double doubleValue = 0.0;
+            bool boolValue = false;
+            char charValue = 0;
+            const char* text = nullptr;
+            std::size_t textSize = 0;
+        };
+
+        template<class T>
+        bool readRaw(const char* data, std::size_t size, std::size_t& offset, T& value) {
+            if(offset > size || size - offset < sizeof(T)) {
+                return false;
+            }
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        // Returns false at the end of the bytes or if they are cut
+        inline bool readArgument(const char* data, std::size_t size, std::size_t& offset, ArgumentView& argument) {
+            char type;
+            if(!readRaw(data, size, offset, type)) {
+                return false;
+            }
+            argument.type = static_cast<ArgumentType>(type);
+            switch(argument.type) {
+            case ArgumentType::Int:
+                return readRaw(data, size, offset, argument.intValue);
+            case ArgumentType::UInt:
+                return readRaw(data, size, offset, argument.uintValue);
+            case ArgumentType::Float:
+                return readRaw(data, size, offset, argument.floatValue);
+            case ArgumentType::Double:
+                return readRaw(data, size, offset, argument.doubleValue);
+            case ArgumentType::Bool: {
+                char value;
+                if(!readRaw(data, size, offset, value)) {
+                    return false;
+                }
+                argument.boolValue = value != 0;
+                return true;
+            }
+            case ArgumentType::Char:
+                return readRaw(data, size, offset, argument.charValue);
+            case ArgumentType::String: {
+                std::uint32_t length;
+                if(!readRaw(data, size, offset, length) || size - offset < length) {
+                    return false;
+                }
+                argument.text = data + offset;
+                argument.textSize = length;
+                offset += length;
+                return true;
+            }
+            default:
+                offset = size;
+                return false;
+            }
+        }
+
+        inline void formatArgument(std::string& out, const ArgumentView& argument) {
+            char text[MaxNumberSize];
+            switch(argument.type) {
+            case ArgumentType::Int:
+                out.append(text, writeInteger(text, argument.intValue));
+                break;
+            case ArgumentType::UInt:
+                out.append(text, writeInteger(text, argument.uintValue));
+                break;
+            case ArgumentType::Float:
+                // Same output as the floats streamed in a record
+                out.append(text, writeFloat(text, argument.floatValue));
+                break;
+            case ArgumentType::Double:
+                // Same output as the doubles streamed in a record
+                out.append(text, writeDouble(text, argument.doubleValue));
+                break;
+            case ArgumentType::Bool:
+                // Same output as the bools streamed in a record
+                out.push_back(argument.boolValue ? '1' : '0');
+                break;
+            case ArgumentType::Char:
+                out.push_back(argument.charValue);
+                break;
+            case ArgumentType::String:
+                out.append(argument.text, argument.textSize);
+                break;
+            }
+        }
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log record whose formatting is deferred
+    ///
+    /// Holds the pointer to the format string and the arguments encoded
+    /// as raw bytes: every argument is a one byte type tag followed by
+    /// its value in the byte order of the machine. The format string must
+    /// outlive the record, string literals being the expected use.
+    ///
+    /// The format uses {} as placeholder for the next argument.
+    ////////////////////////////////////////////////////////////
+    class DeferredLogRecord final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor
+        ///
+        /// The record does not copy the format nor the arguments.
+        ///
+        /// \param format Format string, with {} placeholders
+        /// \param arguments Encoded arguments
+        /// \param size Size of the encoded arguments in bytes
+        ////////////////////////////////////////////////////////////
+        DeferredLogRecord(const char* format, const char* arguments, std::size_t size)
+            : m_format(format)
+            , m_arguments(arguments)
+            , m_size(size) {}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Encode arguments at the end of a buffer
+        ///
+        /// \param out Buffer receiving the encoded arguments
+        /// \param args Arguments to encode
+        ////////////////////////////////////////////////////////////
+        template<class... Args>
+        static void encode(std::string& out, const Args&... args) {
+            detail::encodeArguments(out, args...);
+        }
+
+        const char* getFormat() const {
+            return m_format;
+        }
+
+        const char* getArguments() const {
+            return m_arguments;
+        }
+
+        std::size_t getArgumentsSize() const {
+            return m_size;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Format the record as text at the end of a string
+        ///
+        /// Placeholders without argument are kept as is, and arguments
+        /// without placeholder are ignored.
+        ///
+        /// \param out String receiving the text
+        ////////////////////////////////////////////////////////////
+        void formatTo(std::string& out) const {
+            std::size_t offset = 0;
+            const char* format = m_format;
+            while(*format) {
+                if(format[0] == '{' && format[1] == '}' && priv_formatArgument(out, offset)) {
+                    format += 2;
+                } else {
+                    out.push_back(*format++);
+                }
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Format the record as text
+        ///
+        /// \return The formatted text
+        ////////////////////////////////////////////////////////////
+        std::string toString() const {
+            std::string out;
+            formatTo(out);
+            return out;
+        }
+
+    private:
+        bool priv_formatArgument(std::string& out, std::size_t& offset) const {
+            detail::ArgumentView argument;
+            if(!detail::readArgument(m_arguments, m_size, offset, argument)) {
+                return false;
+            }
+            detail::formatArgument(out, argument);
+            return true;
+        }
+
+    private:
+        const char* m_format;
+        const char* m_arguments;
+        std::size_t m_size;
+    };
+
+}
@@ -23,6 +23,8 @@
 #pragma once
 
 #include <rsm/log/log_device.hpp>
+#include <rsm/log/log_rotation.hpp>
+#include <mutex>
 #include <fstream>
 #include <stdexcept>
 
@@ -33,6 +35,10 @@ namespace rsm {
     ///
     /// This class act as a log device that will log the data into
     /// a specified file.
+    ///
+    /// The file can be rotated by size and by time. The rotation is done
+    /// by the thread writing the record that reaches the limit, which is
+    /// the background thread when the logger is asynchronous.
     ////////////////////////////////////////////////////////////
 	class FileLogDevice final
 		: public LogDevice {
@@ -43,12 +49,18 @@ namespace rsm {
         ///
         /// This constructor will attempt to create the log file. If
         /// the file already exist, it will attempt to open it and
-        /// truncate the content of the file.
+        /// truncate the content of the file, or append to it.
         ///
         /// \param fileName Path to the log file
+        /// \param mode Truncate or append to an existing file
+        /// \param rotation When to start a new file
+        ///
+        /// \throw std::runtime_error if the file can not be created
         ////////////////////////////////////////////////////////////
-		FileLogDevice(const std::string& fileName) {
-			m_file.open(fileName, std::ios::out | std::ios::trunc);
+		FileLogDevice(const std::string& fileName, LogFileMode mode = LogFileMode::Truncate, const LogRotationPolicy& rotation = LogRotationPolicy())
+			: m_fileName(fileName)
+			, m_rotation(fileName, rotation) {
+			priv_open(mode);
 			if(!m_file.is_open()) {
 				throw std::runtime_error("Impossible to create the log file");
 			}
@@ -61,11 +73,48 @@ namespace rsm {
         /// \param message Message to log
         ////////////////////////////////////////////////////////////
 		void log(LogLevel level, const std::string& message) override {
-			m_file << "[" << logLevelToString(level) << "]" << message << "\n";
+			// Formatted first so a record is a single write, whatever the calling thread
+			thread_local std::string line;
+			line.clear();
+			char prefix[LogPrefixFormatter::MaxSize];
+			line.append(prefix, formatPrefix(prefix, level)).append(message).push_back('\n');
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_file.write(line.data(), static_cast<std::streamsize>(line.size()));
+			m_rotation.written(line.size());
+			if(m_rotation.isDue()) {
+				m_file.close();
+				m_rotation.rotateFiles();
+				priv_open(LogFileMode::Truncate);
+			}
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that flushes the stream
+        ///
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_file.flush();
+		}
+
+	private:
+		void priv_open(LogFileMode mode) {
+			if(mode == LogFileMode::Append) {
+				m_file.open(m_fileName, std::ios::out | std::ios::app);
+				m_file.seekp(0, std::ios::end);
+				m_rotation.opened(static_cast<std::size_t>(m_file.tellp()));
+			} else {
+				m_file.open(m_fileName, std::ios::out | std::ios::trunc);
+				m_rotation.opened(0);
+			}
 		}
 
 	private:
+		std::string m_fileName;
 		std::ofstream m_file;
+		std::mutex m_mutex;
+		detail::LogRotation m_rotation;
 	};
 
 }
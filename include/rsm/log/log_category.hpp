@@ -0,0 +1,236 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/logger.hpp>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+////////////////////////////////////////////////////////////
+/// \brief Log a statement to a category, evaluating the streamed
+///        data only if the level is enabled for it
+///
+/// RSM_LOG_TO(network, rsm::LogLevel::Debug) << "Received " << packet;
+////////////////////////////////////////////////////////////
+#define RSM_LOG_TO(category, level) \
+    if(static_cast<int>(level) < RSM_LOG_MIN_LEVEL || !(category).isEnabled(level)) {} \
+    else (category).log(level, RSM_LOG_SOURCE_LOCATION)
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Named logger with its own level and devices
+    ///
+    /// Lets a subsystem log apart from the rest of the program:
+    ///
+    /// static rsm::LogCategory& network = rsm::LogCategory::get("network");
+    /// network.setLogLevelThreshold(rsm::LogLevel::Warning);
+    /// network.info() << "Connected"; // Not logged
+    ///
+    /// A category without devices writes to the devices of the Logger.
+    /// Devices can be shared between categories and the Logger. The
+    /// threshold of a category replaces the one of the Logger, so
+    /// checking a level reads one value of the category.
+    ///
+    /// Categories are also created as plain objects, at namespace scope
+    /// or in tests for instance, without touching the devices of the
+    /// Logger. The records go through the background thread of the
+    /// Logger when it is asynchronous, holding the devices of the
+    /// category until they are written, so a category can be destroyed
+    /// with records still queued.
+    ////////////////////////////////////////////////////////////
+    class LogCategory final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with the name of the category
+        ///
+        /// \param name Name of the category
+        ////////////////////////////////////////////////////////////
+        explicit LogCategory(std::string name)
+            : m_name(std::move(name))
+            , m_threshold(LogLevel::None) {
+        }
+
+        LogCategory(const LogCategory&) = delete;
+        LogCategory& operator=(const LogCategory&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the category of a name, created on the first call
+        ///
+        /// The lookup takes a lock: keep the returned reference, which
+        /// stays valid until the program exits.
+        ///
+        /// \param name Name of the category
+        ///
+        /// \return The category of the name
+        ////////////////////////////////////////////////////////////
+        static LogCategory& get(const std::string& name) {
+            // Never destroyed, so the categories outlive the static objects logging to them
+            static auto* registry = new std::map<std::string, std::unique_ptr<LogCategory>>();
+            static auto* mutex = new std::mutex();
+            std::lock_guard<std::mutex> lock(*mutex);
+            auto& category = (*registry)[name];
+            if(!category) {
+                category.reset(new LogCategory(name));
+            }
+            return *category;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the name of the category
+        ///
+        /// \return The name of the category
+        ////////////////////////////////////////////////////////////
+        const std::string& getName() const {
+            return m_name;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Add a logging device to the category
+        ///
+        /// Once a category has a device, it stops writing to the devices
+        /// of the Logger.
+        ///
+        /// \param device Device that will be kept to use for logging, which
+        ///        can be shared with the Logger and other categories
+        ////////////////////////////////////////////////////////////
+        void addLogDevice(std::shared_ptr<LogDevice> device) {
+            m_logDevices.add(std::move(device));
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Remove the devices of the category, which writes to the
+        ///        devices of the Logger again
+        ///
+        ////////////////////////////////////////////////////////////
+        void resetLogDevices() {
+            auto& logger = Logger::loggerImpl();
+            if(const auto writer = logger.priv_asyncWriter()) {
+                writer->flush();
+            }
+            m_logDevices.clear();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the minimum level of the records of the category
+        ///
+        /// \param level Minimum log level, LogLevel::None to log everything
+        ////////////////////////////////////////////////////////////
+        void setLogLevelThreshold(LogLevel level) {
+            m_threshold.store(level, std::memory_order_relaxed);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the minimum level of the records of the category
+        ///
+        /// \return The minimum log level
+        ////////////////////////////////////////////////////////////
+        LogLevel getLogLevelThreshold() const {
+            return m_threshold.load(std::memory_order_relaxed);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Tell if the records of a level are logged by the category
+        ///
+        /// \param level Log level to check
+        ///
+        /// \return true if the level is at least the threshold
+        ////////////////////////////////////////////////////////////
+        bool isEnabled(LogLevel level) const {
+            return level >= getLogLevelThreshold();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Log at a level
+        ///
+        /// \param level Level of logging
+        /// \param location Location of the statement, as captured by RSM_LOG_TO
+        ///
+        /// \return A record builder to use with streaming
+        ////////////////////////////////////////////////////////////
+        LogRecordBuilder log(LogLevel level, const LogSourceLocation& location = LogSourceLocation{ nullptr, 0, nullptr }) const {
+            return LogRecordBuilder(level, isEnabled(level), priv_devices(), location);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Log a record formatted later, as Logger::logDeferred
+        ///
+        /// \param level Level of logging
+        /// \param format Format with {} placeholders, which must outlive
+        ///        the logger, like a string literal
+        /// \param args Arguments replacing the placeholders
+        ////////////////////////////////////////////////////////////
+        template<class... Args>
+        void logDeferred(LogLevel level, const char* format, const Args&... args) const {
+            if(isEnabled(level)) {
+                Logger::priv_logDeferred(priv_devices(), LogSourceLocation{ nullptr, 0, nullptr }, level, format, args...);
+            }
+        }
+
+        LogRecordBuilder debug() const {
+            return log(LogLevel::Debug);
+        }
+
+        LogRecordBuilder info() const {
+            return log(LogLevel::Info);
+        }
+
+        LogRecordBuilder warning() const {
+            return log(LogLevel::Warning);
+        }
+
+        LogRecordBuilder critical() const {
+            return log(LogLevel::Critical);
+        }
+
+        LogRecordBuilder error() const {
+            return log(LogLevel::Error);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Wait until every record logged so far is written and
+        ///        flush the devices of the category
+        ///
+        ////////////////////////////////////////////////////////////
+        void flush() {
+            Logger::flush();
+            for(auto& device : *m_logDevices.load()) {
+                device->flush();
+            }
+        }
+
+    private:
+        const detail::LogDeviceSet* priv_devices() const {
+            return &m_logDevices;
+        }
+
+    private:
+        std::string m_name;
+        std::atomic<LogLevel> m_threshold;
+        detail::LogDeviceSet m_logDevices;
+    };
+
+}
@@ -0,0 +1,188 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RSM_LOG_CLOCK_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define RSM_LOG_CLOCK_TSC
+#endif
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Clock giving the timestamps of the log records
+    ///
+    /// Reading it is cheap: std::chrono::steady_clock by default, or the
+    /// time-stamp counter of the processor once useTsc is called, which
+    /// skips the system call some platforms make for steady_clock. The
+    /// timestamps are converted to dates only when a record is formatted.
+    ///
+    /// Only use the TSC on processors where it is invariant, which is
+    /// the case of current x86 processors.
+    ////////////////////////////////////////////////////////////
+    class LogClock final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the current timestamp
+        ///
+        /// \return Ticks of the clock, in nanoseconds or TSC cycles
+        ////////////////////////////////////////////////////////////
+        static std::uint64_t now() {
+#if defined(RSM_LOG_CLOCK_TSC)
+            if(priv_state().tsc.load(std::memory_order_relaxed)) {
+                return __rdtsc();
+            }
+#endif
+            return priv_steadyNow();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Convert a timestamp to the time of the system clock
+        ///
+        /// \param timestamp Value returned by now
+        ///
+        /// \return The date and time of the timestamp
+        ////////////////////////////////////////////////////////////
+        static std::chrono::system_clock::time_point toSystemTime(std::uint64_t timestamp) {
+            const State& state = priv_state();
+            std::int64_t nanoseconds;
+            if(state.tsc.load(std::memory_order_acquire)) {
+                const auto ticks = static_cast<std::int64_t>(timestamp - state.tscOrigin);
+                nanoseconds = state.steadyOrigin + static_cast<std::int64_t>(ticks * state.nanosecondsPerTick);
+            } else {
+                nanoseconds = static_cast<std::int64_t>(timestamp);
+            }
+            const auto sinceOrigin = std::chrono::nanoseconds(nanoseconds - state.steadyOrigin);
+            return state.systemOrigin + std::chrono::duration_cast<std::chrono::system_clock::duration>(sinceOrigin);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Use the time-stamp counter of the processor
+        ///
+        /// Calibrates the counter against steady_clock, which takes a few
+        /// milliseconds. Must be called before logging.
+        ///
+        /// \return false if the platform has no time-stamp counter
+        ////////////////////////////////////////////////////////////
+        static bool useTsc() {
+#if defined(RSM_LOG_CLOCK_TSC)
+            State& state = priv_state();
+            const std::uint64_t steadyStart = priv_steadyNow();
+            const std::uint64_t tscStart = __rdtsc();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            const std::uint64_t steadyEnd = priv_steadyNow();
+            const std::uint64_t tscEnd = __rdtsc();
+            if(tscEnd <= tscStart) {
+                return false;
+            }
+            state.nanosecondsPerTick = static_cast<double>(steadyEnd - steadyStart) / static_cast<double>(tscEnd - tscStart);
+            state.tscOrigin = tscEnd;
+            state.steadyOrigin = static_cast<std::int64_t>(steadyEnd);
+            state.systemOrigin = std::chrono::system_clock::now();
+            state.tsc.store(true, std::memory_order_release);
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Tell if the time-stamp counter is used
+        ///
+        /// \return true after a successful call to useTsc
+        ////////////////////////////////////////////////////////////
+        static bool isUsingTsc() {
+            return priv_state().tsc.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // Matches the steady and system clocks at a given instant
+        struct State {
+            State()
+                : tsc(false)
+                , tscOrigin(0)
+                , nanosecondsPerTick(1.0)
+                , steadyOrigin(static_cast<std::int64_t>(priv_steadyNow()))
+                , systemOrigin(std::chrono::system_clock::now()) {}
+
+            std::atomic<bool> tsc;
+            std::uint64_t tscOrigin;
+            double nanosecondsPerTick;
+            std::int64_t steadyOrigin;
+            std::chrono::system_clock::time_point systemOrigin;
+        };
+
+        static State& priv_state() {
+            static State state;
+            return state;
+        }
+
+        static std::uint64_t priv_steadyNow() {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    };
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Timestamp of the record being written by this thread
+        ///
+        /// Set by the logger around the calls to the devices, so they
+        /// prefix the records with the time they were logged at, not the
+        /// time the background thread writes them. Zero outside of them.
+        ////////////////////////////////////////////////////////////
+        inline std::uint64_t& recordTimestamp() {
+            thread_local std::uint64_t timestamp = 0;
+            return timestamp;
+        }
+
+        class RecordTimestampScope final {
+        public:
+            explicit RecordTimestampScope(std::uint64_t timestamp)
+                : m_previous(recordTimestamp()) {
+                recordTimestamp() = timestamp;
+            }
+
+            ~RecordTimestampScope() {
+                recordTimestamp() = m_previous;
+            }
+
+            RecordTimestampScope(const RecordTimestampScope&) = delete;
+            RecordTimestampScope& operator=(const RecordTimestampScope&) = delete;
+
+        private:
+            std::uint64_t m_previous;
+        };
+
+    }
+
+}
@@ -22,49 +22,16 @@
 
 #pragma once
 
+#include <rsm/log/log_level.hpp>
+#include <rsm/log/log_prefix.hpp>
+#include <rsm/log/deferred_log_record.hpp>
+#include <rsm/log/log_fields.hpp>
+#include <atomic>
 #include <memory>
 #include <string>
 
 namespace rsm {
 	
-    ////////////////////////////////////////////////////////////
-    /// \brief Enum class of the log levels
-    ///
-    ////////////////////////////////////////////////////////////
-	enum class LogLevel {
-		None,
-		Debug,
-		Info,
-		Warning,
-		Critical,
-		Error
-	};
-
-    ////////////////////////////////////////////////////////////
-    /// \brief Utility function to return the string definition
-    ///        of the log levels
-    ///
-    /// \param level Log level to get the string version
-    ///
-    /// \return A string representing the log level
-    ////////////////////////////////////////////////////////////
-	std::string logLevelToString(LogLevel level) {
-		switch (level) {
-		case LogLevel::Debug:
-			return "Debug";
-		case LogLevel::Info:
-			return "Info";
-		case LogLevel::Warning:
-			return "Warning";
-		case LogLevel::Critical:
-			return "Critical";
-		case LogLevel::Error:
-			return "Error";
-		default:
-			return "None";
-		}
-	}
-
     ////////////////////////////////////////////////////////////
     /// \brief Log device class
     ///
@@ -72,6 +39,12 @@ namespace rsm {
     /// It is the interface for the log device used by the logger.
     ///
     /// Inheriting class should define how the logging is done.
+    ///
+    /// A device can ignore the records below a level of its own, without
+    /// changing what the other devices receive.
+    ///
+    /// Text devices start their lines with the prefix set with setPrefix,
+    /// written by formatPrefix.
     ////////////////////////////////////////////////////////////
 	class LogDevice {
 	public:
@@ -89,8 +62,109 @@ namespace rsm {
         ////////////////////////////////////////////////////////////
 		virtual void log(LogLevel level, const std::string& message) = 0;
 
+        ////////////////////////////////////////////////////////////
+        /// \brief Virtual function called by the logger for deferred records
+        ///
+        /// Formats the record and calls log by default. Devices able to
+        /// store the record without formatting it can override it.
+        ///
+        /// \param level Log level of the log
+        /// \param record Record to be logged
+        ////////////////////////////////////////////////////////////
+		virtual void logDeferred(LogLevel level, const DeferredLogRecord& record) {
+			log(level, record.toString());
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Virtual function called by the logger for records with fields
+        ///
+        /// Appends the fields to the message as " key=value" and calls log
+        /// by default. Devices keeping the fields typed can override it.
+        ///
+        /// \param level Log level of the log
+        /// \param message Message to be logged
+        /// \param fields Typed fields of the record
+        ////////////////////////////////////////////////////////////
+		virtual void logStructured(LogLevel level, const std::string& message, const LogFields& fields) {
+			std::string text = message;
+			fields.formatTo(text);
+			log(level, text);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write the buffered data, if any
+        ///
+        /// Called by the logger when it is flushed. Does nothing by default.
+        ////////////////////////////////////////////////////////////
+		virtual void flush() {}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the minimum level of the records given to this device
+        ///
+        /// \param level Records below this level are not logged by the device
+        ////////////////////////////////////////////////////////////
+		void setLogLevel(LogLevel level) {
+			m_level.store(level, std::memory_order_relaxed);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the minimum level of the records given to this device
+        ///
+        /// \return The minimum log level, LogLevel::None by default
+        ////////////////////////////////////////////////////////////
+		LogLevel getLogLevel() const {
+			return m_level.load(std::memory_order_relaxed);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Tell if the device logs the records of a level
+        ///
+        /// \param level Log level of the record
+        ///
+        /// \return true if the level is at least the minimum of the device
+        ////////////////////////////////////////////////////////////
+		bool isEnabled(LogLevel level) const {
+			return level >= getLogLevel();
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the fields written before the messages
+        ///
+        /// Must be called before the device is used for logging.
+        ///
+        /// \param prefix Fields of the prefix
+        ////////////////////////////////////////////////////////////
+		void setPrefix(const LogPrefix& prefix) {
+			m_prefix = LogPrefixFormatter(prefix);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the fields written before the messages
+        ///
+        /// \return The fields of the prefix, only the level by default
+        ////////////////////////////////////////////////////////////
+		const LogPrefix& getPrefix() const {
+			return m_prefix.getPrefix();
+		}
+
 	protected:
 		LogDevice() = default;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write the prefix of a record, without allocating
+        ///
+        /// \param out Buffer of at least LogPrefixFormatter::MaxSize characters
+        /// \param level Log level of the record
+        ///
+        /// \return The number of characters written
+        ////////////////////////////////////////////////////////////
+		std::size_t formatPrefix(char* out, LogLevel level) const {
+			return m_prefix.format(out, level);
+		}
+
+	private:
+		std::atomic<LogLevel> m_level{LogLevel::None};
+		LogPrefixFormatter m_prefix;
 	};
 
 }
@@ -0,0 +1,85 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rsm {
+
+    namespace detail {
+
+        // Devices are shared by the Logger and the log categories
+        using LogDeviceList = std::vector<std::shared_ptr<LogDevice>>;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief List of devices replaced as a whole when it changes
+        ///
+        /// Loggers take a snapshot of the list and write to it without
+        /// lock, so a device added or removed never waits for a record
+        /// being written, nor the opposite. The mutex only orders the
+        /// changes of the list; no device is written, flushed or
+        /// destroyed while it is held. A removed device is destroyed
+        /// once the last snapshot holding it is released.
+        ////////////////////////////////////////////////////////////
+        class LogDeviceSet final {
+        public:
+            using Snapshot = std::shared_ptr<const LogDeviceList>;
+
+            LogDeviceSet()
+                : m_devices(std::make_shared<const LogDeviceList>()) {
+            }
+
+            LogDeviceSet(const LogDeviceSet&) = delete;
+            LogDeviceSet& operator=(const LogDeviceSet&) = delete;
+
+            // The devices at the time of the call, unchanged by later calls to add and clear
+            Snapshot load() const {
+                return std::atomic_load_explicit(&m_devices, std::memory_order_acquire);
+            }
+
+            void add(std::shared_ptr<LogDevice> device) {
+                Snapshot previous;
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto devices = std::make_shared<LogDeviceList>(*load());
+                devices->emplace_back(std::move(device));
+                previous = std::atomic_exchange_explicit(&m_devices, Snapshot(std::move(devices)), std::memory_order_acq_rel);
+            }
+
+            void clear() {
+                Snapshot previous;
+                std::lock_guard<std::mutex> lock(m_mutex);
+                previous = std::atomic_exchange_explicit(&m_devices, std::make_shared<const LogDeviceList>(), std::memory_order_acq_rel);
+            }
+
+        private:
+            std::mutex m_mutex;
+            Snapshot m_devices;
+        };
+
+    }
+
+}
@@ -0,0 +1,171 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/deferred_log_record.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace rsm {
+
+    namespace detail {
+
+        // Quoted with the escapes of JSON, so a value can not end the quotes or the line
+        inline void appendQuotedString(std::string& out, const char* text, std::size_t size) {
+            out.push_back('"');
+            for(std::size_t i = 0; i < size; ++i) {
+                const auto character = static_cast<unsigned char>(text[i]);
+                switch(character) {
+                case '"':
+                    out.append("\\\"");
+                    break;
+                case '\\':
+                    out.append("\\\\");
+                    break;
+                case '\n':
+                    out.append("\\n");
+                    break;
+                case '\r':
+                    out.append("\\r");
+                    break;
+                case '\t':
+                    out.append("\\t");
+                    break;
+                default:
+                    if(character < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+                        out.append(escaped);
+                    } else {
+                        out.push_back(static_cast<char>(character));
+                    }
+                }
+            }
+            out.push_back('"');
+        }
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Typed field of a structured log record
+    ///
+    ////////////////////////////////////////////////////////////
+    struct LogField {
+        const char* key;
+        std::size_t keySize;
+        detail::ArgumentView value;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Typed key-value fields attached to a log record
+    ///
+    /// Every field is encoded as the length of its key (uint32), the key,
+    /// then its value like an argument of a DeferredLogRecord: a one byte
+    /// type tag followed by the raw value. Does not copy the bytes.
+    ////////////////////////////////////////////////////////////
+    class LogFields final {
+    public:
+        LogFields(const char* data, std::size_t size)
+            : m_data(data)
+            , m_size(size) {}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Encode a field at the end of a buffer
+        ///
+        /// \param out Buffer receiving the encoded field
+        /// \param key Name of the field
+        /// \param value Value of the field, types other than the numbers,
+        ///        characters and strings being formatted with operator<<
+        ////////////////////////////////////////////////////////////
+        template<class T>
+        static void encode(std::string& out, const char* key, const T& value) {
+            const auto length = static_cast<std::uint32_t>(std::strlen(key));
+            out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.append(key, length);
+            detail::encodeArgument(out, value);
+        }
+
+        bool empty() const {
+            return m_size == 0;
+        }
+
+        const char* getData() const {
+            return m_data;
+        }
+
+        std::size_t getSize() const {
+            return m_size;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Call a function for every field, in the order they were added
+        ///
+        /// \param function Function called with a const LogField&
+        ////////////////////////////////////////////////////////////
+        template<class Function>
+        void forEach(Function&& function) const {
+            std::size_t offset = 0;
+            LogField field;
+            while(offset < m_size) {
+                std::uint32_t length;
+                if(!detail::readRaw(m_data, m_size, offset, length) || m_size - offset < length) {
+                    return;
+                }
+                field.key = m_data + offset;
+                field.keySize = length;
+                offset += length;
+                if(!detail::readArgument(m_data, m_size, offset, field.value)) {
+                    return;
+                }
+                function(static_cast<const LogField&>(field));
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Format the fields as text at the end of a string
+        ///
+        /// Every field is written as " key=value", strings being quoted
+        /// with their quotes, backslashes and control characters escaped.
+        ///
+        /// \param out String receiving the text
+        ////////////////////////////////////////////////////////////
+        void formatTo(std::string& out) const {
+            forEach([&out](const LogField& field) {
+                out.push_back(' ');
+                out.append(field.key, field.keySize);
+                out.push_back('=');
+                if(field.value.type == detail::ArgumentType::String) {
+                    detail::appendQuotedString(out, field.value.text, field.value.textSize);
+                } else {
+                    detail::formatArgument(out, field.value);
+                }
+            });
+        }
+
+    private:
+        const char* m_data;
+        std::size_t m_size;
+    };
+
+}
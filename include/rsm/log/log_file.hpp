@@ -0,0 +1,163 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#define RSM_LOG_FILE_POSIX
+#elif defined(_WIN32)
+#include <io.h>
+#endif
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Unbuffered log file
+        ///
+        /// Every write is a single system call on POSIX systems, the
+        /// callers doing their own buffering. Other platforms go
+        /// through an unbuffered std::FILE.
+        ////////////////////////////////////////////////////////////
+        class LogFile final {
+        public:
+            LogFile() = default;
+
+            ~LogFile() {
+                close();
+            }
+
+            LogFile(const LogFile&) = delete;
+            LogFile& operator=(const LogFile&) = delete;
+
+            // Returns false if the file can not be opened
+            bool open(const std::string& fileName, bool append) {
+                close();
+#if defined(RSM_LOG_FILE_POSIX)
+                const int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+                m_descriptor = ::open(fileName.c_str(), flags, 0644);
+                return m_descriptor >= 0;
+#else
+                m_file = std::fopen(fileName.c_str(), append ? "ab" : "wb");
+                if(m_file) {
+                    std::setvbuf(m_file, nullptr, _IONBF, 0);
+                }
+                return m_file != nullptr;
+#endif
+            }
+
+            // Current size of the file, 0 if it is unknown
+            std::size_t size() const {
+#if defined(RSM_LOG_FILE_POSIX)
+                const off_t end = ::lseek(m_descriptor, 0, SEEK_END);
+                return end < 0 ? 0 : static_cast<std::size_t>(end);
+#else
+                std::fseek(m_file, 0, SEEK_END);
+                const long end = std::ftell(m_file);
+                return end < 0 ? 0 : static_cast<std::size_t>(end);
+#endif
+            }
+
+            // Cuts the file to a size, the next writes going after it
+            bool truncate(std::size_t size) {
+#if defined(RSM_LOG_FILE_POSIX)
+                return ::ftruncate(m_descriptor, static_cast<off_t>(size)) == 0;
+#elif defined(_WIN32)
+                return std::fflush(m_file) == 0 && _chsize_s(_fileno(m_file), static_cast<__int64>(size)) == 0;
+#else
+                static_cast<void>(size);
+                return false;
+#endif
+            }
+
+            bool isOpen() const {
+#if defined(RSM_LOG_FILE_POSIX)
+                return m_descriptor >= 0;
+#else
+                return m_file != nullptr;
+#endif
+            }
+
+            // Writes everything, retrying after interruptions and partial writes
+            bool write(const char* data, std::size_t size) {
+#if defined(RSM_LOG_FILE_POSIX)
+                while(size > 0) {
+                    const ssize_t written = ::write(m_descriptor, data, size);
+                    if(written < 0) {
+                        if(errno == EINTR) {
+                            continue;
+                        }
+                        return false;
+                    }
+                    data += written;
+                    size -= static_cast<std::size_t>(written);
+                }
+                return true;
+#else
+                return std::fwrite(data, 1, size, m_file) == size;
+#endif
+            }
+
+            // Waits until the written data reaches the disk
+            bool sync() {
+#if defined(RSM_LOG_FILE_POSIX) && defined(__linux__)
+                return ::fdatasync(m_descriptor) == 0;
+#elif defined(RSM_LOG_FILE_POSIX)
+                return ::fsync(m_descriptor) == 0;
+#else
+                return std::fflush(m_file) == 0;
+#endif
+            }
+
+            void close() {
+#if defined(RSM_LOG_FILE_POSIX)
+                if(m_descriptor >= 0) {
+                    ::close(m_descriptor);
+                    m_descriptor = -1;
+                }
+#else
+                if(m_file) {
+                    std::fclose(m_file);
+                    m_file = nullptr;
+                }
+#endif
+            }
+
+        private:
+#if defined(RSM_LOG_FILE_POSIX)
+            int m_descriptor = -1;
+#else
+            std::FILE* m_file = nullptr;
+#endif
+        };
+
+    }
+
+}
@@ -0,0 +1,445 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Size of a buffer holding any number written below
+        ///
+        /// "-1.7976931348623157e+308" is the longest, with 24 characters.
+        ////////////////////////////////////////////////////////////
+        enum : std::size_t { MaxNumberSize = 32 };
+
+        // Writes the digits of value, two at a time
+        inline char* writeNumber(char* out, std::uint64_t value) {
+            static const char pairs[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+            char digits[20];
+            char* position = digits + sizeof(digits);
+            while(value >= 100) {
+                const auto pair = static_cast<std::size_t>(value % 100) * 2;
+                value /= 100;
+                *--position = pairs[pair + 1];
+                *--position = pairs[pair];
+            }
+            if(value >= 10) {
+                const auto pair = static_cast<std::size_t>(value) * 2;
+                *--position = pairs[pair + 1];
+                *--position = pairs[pair];
+            } else {
+                *--position = static_cast<char>('0' + value);
+            }
+            const auto count = static_cast<std::size_t>(digits + sizeof(digits) - position);
+            std::memcpy(out, position, count);
+            return out + count;
+        }
+
+        template<class T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, char*>::type
+        writeInteger(char* out, T value) {
+            return writeNumber(out, static_cast<std::uint64_t>(value));
+        }
+
+        template<class T>
+        typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, char*>::type
+        writeInteger(char* out, T value) {
+            auto magnitude = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+            if(value < 0) {
+                *out++ = '-';
+                magnitude = 0 - magnitude;
+            }
+            return writeNumber(out, magnitude);
+        }
+
+        namespace grisu {
+
+            // Number f * 2^e with a 64 bits significand
+            struct DiyFp {
+                std::uint64_t f;
+                int e;
+            };
+
+            inline DiyFp multiply(const DiyFp& x, const DiyFp& y) {
+                const std::uint64_t mask = 0xffffffffu;
+                const std::uint64_t a = x.f >> 32;
+                const std::uint64_t b = x.f & mask;
+                const std::uint64_t c = y.f >> 32;
+                const std::uint64_t d = y.f & mask;
+                const std::uint64_t ac = a * c;
+                const std::uint64_t bc = b * c;
+                const std::uint64_t ad = a * d;
+                const std::uint64_t bd = b * d;
+                // Rounds the lower half
+                const std::uint64_t middle = (bd >> 32) + (ad & mask) + (bc & mask) + (std::uint64_t(1) << 31);
+                return { ac + (ad >> 32) + (bc >> 32) + (middle >> 32), x.e + y.e + 64 };
+            }
+
+            inline DiyFp normalize(DiyFp x) {
+                while(!(x.f & (std::uint64_t(1) << 63))) {
+                    x.f <<= 1;
+                    --x.e;
+                }
+                return x;
+            }
+
+            // 10^k for k from -348 to 340 by steps of 8, rounded to 64 bits
+            inline DiyFp cachedPower(int index) {
+                static const std::uint64_t significands[] = {
+                0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull, 0xcf42894a5dce35eaull,
+                0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull, 0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full,
+                0xbe5691ef416bd60cull, 0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+                0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull, 0xc21094364dfb5637ull,
+                0x9096ea6f3848984full, 0xd77485cb25823ac7ull, 0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull,
+                0xb23867fb2a35b28eull, 0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+                0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull, 0xb5b5ada8aaff80b8ull,
+                0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull, 0x964e858c91ba2655ull, 0xdff9772470297ebdull,
+                0xa6dfbd9fb8e5b88full, 0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+                0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull, 0xaa242499697392d3ull,
+                0xfd87b5f28300ca0eull, 0xbce5086492111aebull, 0x8cbccc096f5088ccull, 0xd1b71758e219652cull,
+                0x9c40000000000000ull, 0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+                0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull, 0x9f4f2726179a2245ull,
+                0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull, 0x83c7088e1aab65dbull, 0xc45d1df942711d9aull,
+                0x924d692ca61be758ull, 0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+                0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull, 0x952ab45cfa97a0b3ull,
+                0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull, 0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull,
+                0x88fcf317f22241e2ull, 0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+                0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull, 0x8bab8eefb6409c1aull,
+                0xd01fef10a657842cull, 0x9b10a4e5e9913129ull, 0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull,
+                0x80444b5e7aa7cf85ull, 0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+                0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull
+                };
+                static const std::int16_t exponents[] = {
+                -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+                -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+                -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+                -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+                56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+                375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+                694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+                1013, 1039, 1066
+                };
+                return { significands[index], exponents[index] };
+            }
+
+            // Power of ten bringing the binary exponent e close to -61, K being its decimal exponent negated
+            inline DiyFp cachedPowerFor(int e, int& K) {
+                const double dk = (-61 - e) * 0.30102999566398114 + 347;
+                int k = static_cast<int>(dk);
+                if(dk - k > 0.0) {
+                    ++k;
+                }
+                const int index = (k >> 3) + 1;
+                K = -(-348 + index * 8);
+                return cachedPower(index);
+            }
+
+            // Moves the last digit towards the value while it stays between the bounds
+            inline void round(char* digits, int length, std::uint64_t delta, std::uint64_t rest, std::uint64_t tenKappa, std::uint64_t distance) {
+                while(rest < distance && delta - rest >= tenKappa &&
+                      (rest + tenKappa < distance || distance - rest > rest + tenKappa - distance)) {
+                    --digits[length - 1];
+                    rest += tenKappa;
+                }
+            }
+
+            // Fewest digits of the upper bound keeping the number above the lower bound
+            inline int generateDigits(const DiyFp& w, const DiyFp& upper, std::uint64_t delta, char* digits, int& K) {
+                static const std::uint64_t powers[] = {
+                    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+                    10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull,
+                    1000000000000000ull, 10000000000000000ull, 100000000000000000ull, 1000000000000000000ull,
+                    10000000000000000000ull
+                };
+                const int shift = -upper.e;
+                const std::uint64_t one = std::uint64_t(1) << shift;
+                const std::uint64_t distance = upper.f - w.f;
+                auto integral = static_cast<std::uint32_t>(upper.f >> shift);
+                std::uint64_t fractional = upper.f & (one - 1);
+
+                int kappa = 1;
+                while(kappa < 10 && integral >= powers[kappa]) {
+                    ++kappa;
+                }
+                int length = 0;
+                while(kappa > 0) {
+                    const auto power = static_cast<std::uint32_t>(powers[kappa - 1]);
+                    const std::uint32_t digit = integral / power;
+                    integral %= power;
+                    if(digit != 0 || length != 0) {
+                        digits[length++] = static_cast<char>('0' + digit);
+                    }
+                    --kappa;
+                    const std::uint64_t rest = (static_cast<std::uint64_t>(integral) << shift) + fractional;
+                    if(rest <= delta) {
+                        K += kappa;
+                        round(digits, length, delta, rest, powers[kappa] << shift, distance);
+                        return length;
+                    }
+                }
+                while(true) {
+                    fractional *= 10;
+                    delta *= 10;
+                    const auto digit = static_cast<char>(fractional >> shift);
+                    if(digit != 0 || length != 0) {
+                        digits[length++] = static_cast<char>('0' + digit);
+                    }
+                    fractional &= one - 1;
+                    --kappa;
+                    if(fractional < delta) {
+                        K += kappa;
+                        const int index = -kappa;
+                        round(digits, length, delta, fractional, one, distance * (index < 20 ? powers[index] : 0));
+                        return length;
+                    }
+                }
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Shortest digits of the positive number v, Grisu2
+            ///
+            /// Writes the digits D of the value D * 10^K, always reading
+            /// back as the value. The bounds between the value and its
+            /// neighbours are excluded, and narrowed by the rounding of the
+            /// cached powers, so a few values in a thousand get more digits
+            /// than the shortest.
+            ///
+            /// \param v Significand and exponent of the value
+            /// \param hiddenBit Implicit bit of the normal significands of
+            ///        the type of the value
+            ///
+            /// \return The number of digits
+            ////////////////////////////////////////////////////////////
+            inline int shortestDigits(const DiyFp& v, std::uint64_t hiddenBit, char* digits, int& K) {
+                // Middles between the value and its neighbours
+                const DiyFp upper = normalize({ (v.f << 1) + 1, v.e - 1 });
+                DiyFp lower = v.f == hiddenBit ? DiyFp{ (v.f << 2) - 1, v.e - 2 } : DiyFp{ (v.f << 1) - 1, v.e - 1 };
+                lower.f <<= lower.e - upper.e;
+                lower.e = upper.e;
+
+                const DiyFp power = cachedPowerFor(upper.e, K);
+                const DiyFp w = multiply(normalize(v), power);
+                DiyFp scaledUpper = multiply(upper, power);
+                DiyFp scaledLower = multiply(lower, power);
+                ++scaledLower.f;
+                --scaledUpper.f;
+                int length = generateDigits(w, scaledUpper, scaledUpper.f - scaledLower.f, digits, K);
+                while(length > 1 && digits[length - 1] == '0') {
+                    --length;
+                    ++K;
+                }
+                return length;
+            }
+
+            // At most 17 digits
+            inline int shortestDigits(double value, char* digits, int& K) {
+                std::uint64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                const std::uint64_t hiddenBit = std::uint64_t(1) << 52;
+                const int biasedExponent = static_cast<int>((bits >> 52) & 0x7ff);
+                DiyFp v = { bits & (hiddenBit - 1), -1074 };
+                if(biasedExponent != 0) {
+                    v.f += hiddenBit;
+                    v.e = biasedExponent - 1075;
+                }
+                return shortestDigits(v, hiddenBit, digits, K);
+            }
+
+            // At most 9 digits, reading back as the same float
+            inline int shortestDigits(float value, char* digits, int& K) {
+                std::uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                const std::uint64_t hiddenBit = std::uint64_t(1) << 23;
+                const int biasedExponent = static_cast<int>((bits >> 23) & 0xff);
+                DiyFp v = { bits & (hiddenBit - 1), -149 };
+                if(biasedExponent != 0) {
+                    v.f += hiddenBit;
+                    v.e = biasedExponent - 150;
+                }
+                return shortestDigits(v, hiddenBit, digits, K);
+            }
+
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Writes a short text reading back as the same number
+        ///
+        /// Numbers of the exact range whose integer N below exactIntegers
+        /// gives them back as N / 10^decimals are written from the
+        /// smallest such count of decimals, the division of exact numbers
+        /// of the type T being rounded like the parsing of the text. The
+        /// others take their digits from Grisu2: the text always reads
+        /// back as the number, but is longer than the shortest for about
+        /// 2 numbers in 10000, for example 9.999999999999999e+22 for 1e23.
+        ///
+        /// The notation is the one of printf with %.17g: fixed from 1e-4 to
+        /// 1e17, scientific with at least two exponent digits outside.
+        ///
+        /// \param out Buffer of at least MaxNumberSize characters
+        /// \param value Value to write
+        /// \param exactMin Smallest number tried as N / 10^decimals
+        /// \param exactMax Number above the ones tried as N / 10^decimals
+        /// \param exactIntegers Integers below it are exact numbers of the type T
+        /// \param maxDecimals Powers of ten up to 10^maxDecimals are exact
+        ///        numbers of the type T
+        ///
+        /// \return The end of the written text
+        ////////////////////////////////////////////////////////////
+        template<class T>
+        char* writeFloatingPoint(char* out, T value, T exactMin, T exactMax, T exactIntegers, int maxDecimals) {
+            if(std::isnan(value)) {
+                std::memcpy(out, "nan", 3);
+                return out + 3;
+            }
+            if(std::signbit(value)) {
+                *out++ = '-';
+                value = -value;
+            }
+            if(std::isinf(value)) {
+                std::memcpy(out, "inf", 3);
+                return out + 3;
+            }
+            if(value == 0) {
+                *out = '0';
+                return out + 1;
+            }
+
+            char digits[MaxNumberSize];
+            int length = 0;
+            // Decimal exponent of the last digit
+            int K = 0;
+
+            if(value >= exactMin && value < exactMax) {
+                T scale = 1;
+                for(int decimals = 0; decimals <= maxDecimals; ++decimals, scale *= 10) {
+                    const T scaled = std::floor(value * scale + T(0.5));
+                    if(scaled >= exactIntegers) {
+                        break;
+                    }
+                    const T parsed = scaled / scale;
+                    if(parsed == value) {
+                        length = static_cast<int>(writeNumber(digits, static_cast<std::uint64_t>(scaled)) - digits);
+                        K = -decimals;
+                        break;
+                    }
+                }
+            }
+            if(length == 0) {
+                length = grisu::shortestDigits(value, digits, K);
+            }
+
+            // Digits before the decimal point
+            const int point = length + K;
+            if(point > -4 && point <= 17) {
+                if(K >= 0) {
+                    std::memcpy(out, digits, static_cast<std::size_t>(length));
+                    out += length;
+                    std::memset(out, '0', static_cast<std::size_t>(K));
+                    return out + K;
+                }
+                if(point > 0) {
+                    std::memcpy(out, digits, static_cast<std::size_t>(point));
+                    out += point;
+                    *out++ = '.';
+                    std::memcpy(out, digits + point, static_cast<std::size_t>(length - point));
+                    return out + length - point;
+                }
+                *out++ = '0';
+                *out++ = '.';
+                std::memset(out, '0', static_cast<std::size_t>(-point));
+                out += -point;
+                std::memcpy(out, digits, static_cast<std::size_t>(length));
+                return out + length;
+            }
+
+            *out++ = digits[0];
+            if(length > 1) {
+                *out++ = '.';
+                std::memcpy(out, digits + 1, static_cast<std::size_t>(length - 1));
+                out += length - 1;
+            }
+            int exponent = point - 1;
+            *out++ = 'e';
+            *out++ = exponent < 0 ? '-' : '+';
+            if(exponent < 0) {
+                exponent = -exponent;
+            }
+            if(exponent < 10) {
+                *out++ = '0';
+            }
+            return writeNumber(out, static_cast<std::uint64_t>(exponent));
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Writes a short text reading back as the same double
+        ///
+        /// The text is the shortest for every number from 1e-5 to 1e15
+        /// written with up to 15 significant digits, and for most others.
+        ///
+        /// \see writeFloatingPoint
+        ////////////////////////////////////////////////////////////
+        inline char* writeDouble(char* out, double value) {
+            return writeFloatingPoint(out, value, 1e-5, 1e15, 9007199254740992.0, 22);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Writes a short text reading back as the same float
+        ///
+        /// The text is the shortest for every number from 1e-4 to 1e7
+        /// written with up to 6 significant digits, and for most others.
+        ///
+        /// \see writeFloatingPoint
+        ////////////////////////////////////////////////////////////
+        inline char* writeFloat(char* out, float value) {
+            return writeFloatingPoint(out, value, 1e-4f, 1e7f, 16777216.0f, 10);
+        }
+
+        inline char* writePointer(char* out, const void* pointer) {
+            static const char hexDigits[] = "0123456789abcdef";
+            auto value = reinterpret_cast<std::uintptr_t>(pointer);
+            char digits[2 * sizeof(value)];
+            int count = 0;
+            do {
+                digits[count++] = hexDigits[value & 0xf];
+                value >>= 4;
+            } while(value != 0);
+            *out++ = '0';
+            *out++ = 'x';
+            while(count > 0) {
+                *out++ = digits[--count];
+            }
+            return out;
+        }
+
+    }
+
+}
@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace rsm {
+	
+    ////////////////////////////////////////////////////////////
+    /// \brief Enum class of the log levels
+    ///
+    ////////////////////////////////////////////////////////////
+	enum class LogLevel {
+		None,
+		Debug,
+		Info,
+		Warning,
+		Critical,
+		Error
+	};
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Return the name of a log level
+    ///
+    /// \param level Log level to get the name
+    ///
+    /// \return A static null-terminated string naming the log level
+    ////////////////////////////////////////////////////////////
+	constexpr const char* logLevelName(LogLevel level) {
+		switch (level) {
+		case LogLevel::Debug:
+			return "Debug";
+		case LogLevel::Info:
+			return "Info";
+		case LogLevel::Warning:
+			return "Warning";
+		case LogLevel::Critical:
+			return "Critical";
+		case LogLevel::Error:
+			return "Error";
+		default:
+			return "None";
+		}
+	}
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Return the length of the name of a log level
+    ///
+    /// \param level Log level to get the length of the name
+    ///
+    /// \return The number of characters of logLevelName(level)
+    ////////////////////////////////////////////////////////////
+	constexpr std::size_t logLevelNameLength(LogLevel level) {
+		std::size_t length = 0;
+		for(const char* name = logLevelName(level); name[length] != '\0';) {
+			++length;
+		}
+		return length;
+	}
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Utility function to return the string definition
+    ///        of the log levels
+    ///
+    /// Allocates on every call unless the string is small enough for the
+    /// library to store it inline; prefer logLevelName in hot paths.
+    ///
+    /// \param level Log level to get the string version
+    ///
+    /// \return A string representing the log level
+    ////////////////////////////////////////////////////////////
+	inline std::string logLevelToString(LogLevel level) {
+		return std::string(logLevelName(level), logLevelNameLength(level));
+	}
+
+}
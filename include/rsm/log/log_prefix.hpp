@@ -0,0 +1,261 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_level.hpp>
+#include <rsm/log/log_clock.hpp>
+#include <rsm/log/log_format.hpp>
+#include <rsm/log/log_source_location.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Fields written before the message by the text devices
+    ///
+    /// In this order: [2018-05-21 14:03:12.123456][12345][Info][main.cpp:42][run]message
+    ////////////////////////////////////////////////////////////
+    struct LogPrefix {
+        /// Local date and time the record was logged at, to the microsecond
+        bool time = false;
+        /// Identifier of the thread logging the record, also in asynchronous mode
+        bool threadId = false;
+        /// Name of the level of the record
+        bool level = true;
+        /// Source file name and line of the statement, for the records
+        /// logged with the RSM_LOG macros
+        bool location = false;
+        /// Function of the statement, for the records logged with the
+        /// RSM_LOG macros
+        bool function = false;
+    };
+
+    namespace detail {
+
+        // Writes value on exactly width digits, padded with zeros
+        inline char* writeDigits(char* out, std::uint64_t value, int width) {
+            for(int i = width - 1; i >= 0; --i) {
+                out[i] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+            return out + width;
+        }
+
+        // Small number given by the system on Linux, hash of std::thread::id elsewhere
+        inline std::uint64_t currentThreadId() {
+#if defined(__linux__)
+            thread_local const std::uint64_t id = static_cast<std::uint64_t>(::syscall(SYS_gettid));
+#else
+            thread_local const std::uint64_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+            return id;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Thread which logged the record being written
+        ///
+        /// Set by the background thread of the asynchronous logger, so
+        /// the prefix shows the thread logging the record, not the one
+        /// writing it. Zero, for the current thread, outside of it.
+        ////////////////////////////////////////////////////////////
+        inline std::uint64_t& recordThreadId() {
+            thread_local std::uint64_t id = 0;
+            return id;
+        }
+
+        class RecordThreadIdScope final {
+        public:
+            explicit RecordThreadIdScope(std::uint64_t id)
+                : m_previous(recordThreadId()) {
+                recordThreadId() = id;
+            }
+
+            ~RecordThreadIdScope() {
+                recordThreadId() = m_previous;
+            }
+
+            RecordThreadIdScope(const RecordThreadIdScope&) = delete;
+            RecordThreadIdScope& operator=(const RecordThreadIdScope&) = delete;
+
+        private:
+            std::uint64_t m_previous;
+        };
+
+        inline bool localTime(std::time_t time, std::tm& out) {
+#if defined(_WIN32)
+            return localtime_s(&out, &time) == 0;
+#else
+            return localtime_r(&time, &out) != nullptr;
+#endif
+        }
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Formats the prefix of the records without allocating
+    ///
+    /// Shared by the text devices, which write the prefix in a buffer
+    /// of MaxSize characters.
+    ///
+    /// The date and time down to the second are formatted once per second
+    /// and per thread, then copied: only the microseconds are formatted
+    /// for every record.
+    ////////////////////////////////////////////////////////////
+    class LogPrefixFormatter final {
+    public:
+        /// Maximum number of characters written by format
+        static constexpr std::size_t MaxSize = 256;
+
+        /// Longer file and function names keep their last characters
+        static constexpr std::size_t MaxNameSize = 64;
+
+        /// Length of "2018-05-21 14:03:12"
+        static constexpr std::size_t DateSize = 19;
+
+        explicit LogPrefixFormatter(const LogPrefix& prefix = LogPrefix())
+            : m_prefix(prefix) {}
+
+        const LogPrefix& getPrefix() const {
+            return m_prefix;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write the prefix of a record
+        ///
+        /// The time is the one the logger captured for the record being
+        /// written, or the current time when a device is used directly.
+        ///
+        /// \param out Buffer of at least MaxSize characters
+        /// \param level Log level of the record
+        ///
+        /// \return The number of characters written
+        ////////////////////////////////////////////////////////////
+        std::size_t format(char* out, LogLevel level) const {
+            char* position = out;
+            if(m_prefix.time) {
+                *position++ = '[';
+                std::uint64_t timestamp = detail::recordTimestamp();
+                if(timestamp == 0) {
+                    timestamp = LogClock::now();
+                }
+                position = priv_writeTime(position, LogClock::toSystemTime(timestamp));
+                *position++ = ']';
+            }
+            if(m_prefix.threadId) {
+                *position++ = '[';
+                const std::uint64_t id = detail::recordThreadId();
+                position = detail::writeNumber(position, id != 0 ? id : detail::currentThreadId());
+                *position++ = ']';
+            }
+            if(m_prefix.level) {
+                const std::size_t length = logLevelNameLength(level);
+                *position++ = '[';
+                std::memcpy(position, logLevelName(level), length);
+                position += length;
+                *position++ = ']';
+            }
+            const LogSourceLocation& location = detail::recordLocation();
+            if(m_prefix.location && location.file) {
+                *position++ = '[';
+                position = priv_writeName(position, detail::fileName(location.file));
+                *position++ = ':';
+                position = detail::writeNumber(position, static_cast<std::uint64_t>(location.line));
+                *position++ = ']';
+            }
+            if(m_prefix.function && location.function) {
+                *position++ = '[';
+                position = priv_writeName(position, location.function);
+                *position++ = ']';
+            }
+            return static_cast<std::size_t>(position - out);
+        }
+
+    private:
+        // Date and time of the last second formatted by the thread
+        struct DateCache {
+            std::int64_t second = -1;
+            char text[DateSize];
+        };
+
+        static char* priv_writeName(char* out, const char* name) {
+            const std::size_t length = std::strlen(name);
+            std::size_t size = length;
+            if(size > MaxNameSize) {
+                size = MaxNameSize;
+            }
+            std::memcpy(out, name + length - size, size);
+            return out + size;
+        }
+
+        static char* priv_writeTime(char* out, std::chrono::system_clock::time_point time) {
+            const auto sinceEpoch = time.time_since_epoch();
+            auto seconds = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch);
+            if(seconds > sinceEpoch) {
+                seconds -= std::chrono::seconds(1);
+            }
+            const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch - seconds);
+
+            thread_local DateCache cache;
+            if(cache.second != seconds.count()) {
+                priv_formatDate(cache.text, static_cast<std::time_t>(seconds.count()));
+                cache.second = seconds.count();
+            }
+            std::memcpy(out, cache.text, DateSize);
+            out += DateSize;
+            *out++ = '.';
+            return detail::writeDigits(out, static_cast<std::uint64_t>(microseconds.count()), 6);
+        }
+
+        static void priv_formatDate(char* out, std::time_t seconds) {
+            std::tm date;
+            if(!detail::localTime(seconds, date)) {
+                std::memset(&date, 0, sizeof(date));
+            }
+            out = detail::writeDigits(out, static_cast<std::uint64_t>(date.tm_year + 1900), 4);
+            *out++ = '-';
+            out = detail::writeDigits(out, static_cast<std::uint64_t>(date.tm_mon + 1), 2);
+            *out++ = '-';
+            out = detail::writeDigits(out, static_cast<std::uint64_t>(date.tm_mday), 2);
+            *out++ = ' ';
+            out = detail::writeDigits(out, static_cast<std::uint64_t>(date.tm_hour), 2);
+            *out++ = ':';
+            out = detail::writeDigits(out, static_cast<std::uint64_t>(date.tm_min), 2);
+            *out++ = ':';
+            detail::writeDigits(out, static_cast<std::uint64_t>(date.tm_sec), 2);
+        }
+
+    private:
+        LogPrefix m_prefix;
+    };
+
+}
@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief How a file log device opens an existing file
+    ///
+    ////////////////////////////////////////////////////////////
+    enum class LogFileMode {
+        Truncate,
+        Append
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief When a file log device starts a new file
+    ///
+    /// The current file is renamed with the suffix .1, the previous .1
+    /// becomes .2 and so on, the oldest files beyond retainedFiles being
+    /// removed. Both limits are checked after the device writes to the
+    /// file, and are disabled when zero.
+    ////////////////////////////////////////////////////////////
+    struct LogRotationPolicy {
+        /// Size in bytes after which the file is rotated
+        std::size_t maxSize = 0;
+        /// Time after which the file is rotated
+        std::chrono::milliseconds interval = std::chrono::milliseconds(0);
+        /// Number of rotated files kept besides the current one
+        std::size_t retainedFiles = 5;
+    };
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Tracks the size and the age of a log file to rotate it
+        ///
+        ////////////////////////////////////////////////////////////
+        class LogRotation final {
+        public:
+            LogRotation(const std::string& fileName, const LogRotationPolicy& policy)
+                : m_fileName(fileName)
+                , m_policy(policy)
+                , m_size(0)
+                , m_openedAt(std::chrono::steady_clock::now()) {}
+
+            // Called after opening the file, with the size of the existing content
+            void opened(std::size_t size) {
+                m_size = size;
+                m_openedAt = std::chrono::steady_clock::now();
+            }
+
+            void written(std::size_t size) {
+                m_size += size;
+            }
+
+            bool isDue() const {
+                if(m_policy.maxSize > 0 && m_size >= m_policy.maxSize) {
+                    return true;
+                }
+                return m_policy.interval.count() > 0 && std::chrono::steady_clock::now() - m_openedAt >= m_policy.interval;
+            }
+
+            // Renames the closed file and the previous ones, removing the oldest
+            void rotateFiles() const {
+                if(m_policy.retainedFiles == 0) {
+                    std::remove(m_fileName.c_str());
+                    return;
+                }
+                std::remove(priv_rotatedName(m_policy.retainedFiles).c_str());
+                for(std::size_t index = m_policy.retainedFiles; index > 1; --index) {
+                    std::rename(priv_rotatedName(index - 1).c_str(), priv_rotatedName(index).c_str());
+                }
+                std::rename(m_fileName.c_str(), priv_rotatedName(1).c_str());
+            }
+
+        private:
+            std::string priv_rotatedName(std::size_t index) const {
+                return m_fileName + "." + std::to_string(index);
+            }
+
+        private:
+            std::string m_fileName;
+            LogRotationPolicy m_policy;
+            std::size_t m_size;
+            std::chrono::steady_clock::time_point m_openedAt;
+        };
+
+    }
+
+}
@@ -0,0 +1,254 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_level.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace rsm {
+    namespace detail {
+        ////////////////////////////////////////////////////////////
+        /// \brief State of one log statement, for the rate limiting and
+        ///        sampling of the RSM_LOG macros
+        ///
+        /// Each statement has its own constant initialized instance,
+        /// so checking it needs no guard and no lock. The rate limit is
+        /// a token bucket kept as a single theoretical arrival time.
+        ///
+        /// The records rejected by the rate limit are counted, and the
+        /// count is reported in a record of its own the next time the
+        /// statement logs, or when Logger::reportSuppressedRecords is
+        /// called. The counts of all the statements are also reported
+        /// every ReportInterval, when a rate limited statement is checked,
+        /// so that a statement which stopped logging is reported too.
+        ////////////////////////////////////////////////////////////
+        class LogSite final {
+        public:
+            enum : std::int64_t {
+                // Nanoseconds between two reports of all the statements
+                ReportInterval = 1000000000,
+                // Longest interval times burst, keeping the arrival times
+                // and the tolerance far from overflowing
+                MaxInterval = std::int64_t(1) << 61
+            };
+
+            constexpr LogSite(const char* file, int line)
+                : m_file(file)
+                , m_line(line)
+                , m_level(LogLevel::None)
+                , m_count(0)
+                , m_arrivalTime(0)
+                , m_suppressed(0)
+                , m_registered(false)
+                , m_next(nullptr) {
+            }
+
+            LogSite(const LogSite&) = delete;
+            LogSite& operator=(const LogSite&) = delete;
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Tell if a record passes the rate limit set with
+            ///        Logger::setRateLimit
+            ///
+            /// \param level Level of the record
+            ///
+            /// \return true if the record can be logged
+            ////////////////////////////////////////////////////////////
+            bool allowDefault(LogLevel level) {
+                const std::int64_t interval = priv_defaultInterval().load(std::memory_order_relaxed);
+                if(interval == 0) {
+                    return true;
+                }
+                return priv_allow(level, interval, priv_defaultBurst().load(std::memory_order_relaxed));
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Tell if a record passes a rate limit
+            ///
+            /// \param level Level of the record
+            /// \param perSecond Number of records allowed per second
+            /// \param burst Number of records allowed at once after a quiet period
+            ///
+            /// \return true if the record can be logged
+            ////////////////////////////////////////////////////////////
+            bool allowRate(LogLevel level, double perSecond, std::uint32_t burst) {
+                return priv_allow(level, toInterval(perSecond), burst);
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Tell if a record is one of the sampled ones
+            ///
+            /// The first record and then one record every n are logged.
+            /// The skipped records are not reported as suppressed.
+            ///
+            /// \param n Sampling period, 0 and 1 log every record
+            ///
+            /// \return true if the record can be logged
+            ////////////////////////////////////////////////////////////
+            bool sample(std::uint64_t n) {
+                return n <= 1 || m_count.fetch_add(1, std::memory_order_relaxed) % n == 0;
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Take the number of records suppressed since the last call
+            ///
+            /// \return The number of suppressed records
+            ////////////////////////////////////////////////////////////
+            std::uint64_t takeSuppressed() {
+                return m_suppressed.exchange(0, std::memory_order_relaxed);
+            }
+
+            const char* getFile() const {
+                return m_file;
+            }
+
+            int getLine() const {
+                return m_line;
+            }
+
+            LogLevel getLevel() const {
+                return m_level.load(std::memory_order_relaxed);
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Set the rate limit of the statements of the RSM_LOG macros
+            ///
+            /// \param perSecond Number of records allowed per second for
+            ///        each statement, 0 to disable the limit
+            /// \param burst Number of records allowed at once after a quiet period
+            ////////////////////////////////////////////////////////////
+            static void setDefaultRate(double perSecond, std::uint32_t burst) {
+                priv_defaultBurst().store(burst, std::memory_order_relaxed);
+                priv_defaultInterval().store(perSecond > 0.0 ? toInterval(perSecond) : 0, std::memory_order_relaxed);
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Call a function with each statement that suppressed records
+            ///
+            /// \param f Function called with a LogSite&
+            ////////////////////////////////////////////////////////////
+            template<typename F>
+            static void forEachSuppressing(F f) {
+                for(LogSite* site = priv_head().load(std::memory_order_acquire); site; site = site->m_next) {
+                    f(*site);
+                }
+            }
+
+        private:
+            // Clamped, since the conversion of a double out of the range of int64 is undefined
+            static std::int64_t toInterval(double perSecond) {
+                if(!(perSecond > 0.0)) {
+                    return 1;
+                }
+                const double interval = 1e9 / perSecond;
+                return interval < static_cast<double>(MaxInterval) ? static_cast<std::int64_t>(interval) : MaxInterval;
+            }
+
+            static std::int64_t priv_now() {
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            }
+
+            bool priv_allow(LogLevel level, std::int64_t interval, std::uint32_t burst) {
+                const std::int64_t now = priv_now();
+                priv_reportPeriodically(now);
+                if(burst > 1 && interval > MaxInterval / burst) {
+                    interval = MaxInterval / burst;
+                }
+                const std::int64_t tolerance = interval * (burst > 0 ? burst - 1 : 0);
+                std::int64_t arrivalTime = m_arrivalTime.load(std::memory_order_relaxed);
+                for(;;) {
+                    const std::int64_t start = arrivalTime > now ? arrivalTime : now;
+                    if(start - now > tolerance) {
+                        priv_suppress(level);
+                        return false;
+                    }
+                    if(m_arrivalTime.compare_exchange_weak(arrivalTime, start + interval, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                if(m_suppressed.load(std::memory_order_relaxed) != 0) {
+                    priv_reportSuppressed();
+                }
+                return true;
+            }
+
+            void priv_suppress(LogLevel level) {
+                m_level.store(level, std::memory_order_relaxed);
+                m_suppressed.fetch_add(1, std::memory_order_relaxed);
+                if(!m_registered.exchange(true, std::memory_order_relaxed)) {
+                    LogSite* head = priv_head().load(std::memory_order_relaxed);
+                    do {
+                        m_next = head;
+                    } while(!priv_head().compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+                }
+            }
+
+            // One thread reports every ReportInterval
+            static void priv_reportPeriodically(std::int64_t now) {
+                std::int64_t nextReport = priv_nextReport().load(std::memory_order_relaxed);
+                if(now < nextReport || !priv_nextReport().compare_exchange_strong(nextReport, now + ReportInterval, std::memory_order_relaxed)) {
+                    return;
+                }
+                if(priv_head().load(std::memory_order_acquire)) {
+                    priv_reportAll();
+                }
+            }
+
+            // Defined with the Logger, which writes the reports
+            void priv_reportSuppressed();
+            static void priv_reportAll();
+
+            static std::atomic<LogSite*>& priv_head() {
+                static std::atomic<LogSite*> head{nullptr};
+                return head;
+            }
+
+            static std::atomic<std::int64_t>& priv_nextReport() {
+                static std::atomic<std::int64_t> nextReport{0};
+                return nextReport;
+            }
+
+            static std::atomic<std::int64_t>& priv_defaultInterval() {
+                static std::atomic<std::int64_t> interval{0};
+                return interval;
+            }
+
+            static std::atomic<std::uint32_t>& priv_defaultBurst() {
+                static std::atomic<std::uint32_t> burst{1};
+                return burst;
+            }
+
+        private:
+            const char* m_file;
+            int m_line;
+            std::atomic<LogLevel> m_level;
+            std::atomic<std::uint64_t> m_count;
+            std::atomic<std::int64_t> m_arrivalTime;
+            std::atomic<std::uint64_t> m_suppressed;
+            std::atomic<bool> m_registered;
+            LogSite* m_next;
+        };
+    }
+}
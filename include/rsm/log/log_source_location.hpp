@@ -0,0 +1,92 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+////////////////////////////////////////////////////////////
+/// \brief Location of the statement where the macro is expanded
+///
+/// Only pointers to the static strings of the compiler are kept: the
+/// text is copied by the devices that write it.
+////////////////////////////////////////////////////////////
+#define RSM_LOG_SOURCE_LOCATION ::rsm::LogSourceLocation{ __FILE__, __LINE__, __func__ }
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Source file, line and function of a log statement
+    ///
+    /// Captured by the RSM_LOG macros and written in the prefix of the
+    /// records when LogPrefix::location or LogPrefix::function is set.
+    /// The strings are static, so keeping the location costs three
+    /// words per record.
+    ////////////////////////////////////////////////////////////
+    struct LogSourceLocation {
+        /// Path of the source file, nullptr when unknown
+        const char* file;
+        /// Line in the source file
+        int line;
+        /// Name of the function, nullptr when unknown
+        const char* function;
+    };
+
+    namespace detail {
+
+        // Location of the record being written to the devices by the
+        // thread, which devices read from its prefix
+        inline LogSourceLocation& recordLocation() {
+            thread_local LogSourceLocation location = { nullptr, 0, nullptr };
+            return location;
+        }
+
+        class RecordLocationScope final {
+        public:
+            explicit RecordLocationScope(const LogSourceLocation& location)
+                : m_previous(recordLocation()) {
+                recordLocation() = location;
+            }
+
+            ~RecordLocationScope() {
+                recordLocation() = m_previous;
+            }
+
+            RecordLocationScope(const RecordLocationScope&) = delete;
+            RecordLocationScope& operator=(const RecordLocationScope&) = delete;
+
+        private:
+            LogSourceLocation m_previous;
+        };
+
+        // Last component of a path, without copying it
+        inline const char* fileName(const char* path) {
+            const char* name = path;
+            for(const char* c = path; *c != '\0'; ++c) {
+                if(*c == '/' || *c == '\\') {
+                    name = c + 1;
+                }
+            }
+            return name;
+        }
+
+    }
+
+}
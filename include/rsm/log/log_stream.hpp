@@ -0,0 +1,249 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_format.hpp>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Stream buffer appending to a string kept between records
+        ///
+        /// Unlike std::stringbuf, clearing it keeps the memory of the
+        /// string, so a warm buffer formats records without allocating.
+        ////////////////////////////////////////////////////////////
+        class LogStreamBuffer final
+            : public std::streambuf {
+        public:
+            const std::string& str() const {
+                return m_buffer;
+            }
+
+            void clear() {
+                m_buffer.clear();
+            }
+
+            void append(const char* data, std::size_t size) {
+                m_buffer.append(data, size);
+            }
+
+        protected:
+            int_type overflow(int_type character) override {
+                if(!traits_type::eq_int_type(character, traits_type::eof())) {
+                    m_buffer.push_back(traits_type::to_char_type(character));
+                }
+                return traits_type::not_eof(character);
+            }
+
+            std::streamsize xsputn(const char* data, std::streamsize count) override {
+                m_buffer.append(data, static_cast<std::size_t>(count));
+                return count;
+            }
+
+        private:
+            std::string m_buffer;
+        };
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Output stream formatting one record at a time
+        ///
+        ////////////////////////////////////////////////////////////
+        class LogStream final
+            : public std::ostream {
+        public:
+            LogStream()
+                : std::ostream(nullptr) {
+                rdbuf(&m_buffer);
+            }
+
+            const std::string& str() const {
+                return m_buffer.str();
+            }
+
+            // Appends text without going through the stream
+            void append(const char* data, std::size_t size) {
+                m_buffer.append(data, size);
+            }
+
+            // True while no manipulator changed how the values are formatted
+            bool hasDefaultFormat() const {
+                return flags() == (std::ios_base::dec | std::ios_base::skipws) && width() == 0 && precision() == 6;
+            }
+
+            // Encoded key-value fields of the record
+            std::string& fields() {
+                return m_fields;
+            }
+
+            // Empties the record and resets the error state and the format left by the last one
+            void reset() {
+                m_buffer.clear();
+                m_fields.clear();
+                std::ostream::clear();
+                if(!hasDefaultFormat()) {
+                    flags(std::ios_base::dec | std::ios_base::skipws);
+                    width(0);
+                    precision(6);
+                    fill(' ');
+                }
+            }
+
+        private:
+            LogStreamBuffer m_buffer;
+            std::string m_fields;
+        };
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Writes a value streamed in a record
+        ///
+        /// The built-in types are formatted in a fixed buffer appended to
+        /// the record, skipping the locale and the virtual calls of the
+        /// stream. The other types, and every type once a manipulator
+        /// changed the format, are written with their operator<<.
+        ////////////////////////////////////////////////////////////
+        template<class T, class Enable = void>
+        struct LogFormatter {
+            static void write(LogStream& stream, const T& value) {
+                static_cast<std::ostream&>(stream) << value;
+            }
+        };
+
+        template<class T>
+        struct LogFormatter<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value && sizeof(T) >= sizeof(short) &&
+                                                       !std::is_same<T, wchar_t>::value && !std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value>::type> {
+            static void write(LogStream& stream, T value) {
+                if(!stream.hasDefaultFormat()) {
+                    static_cast<std::ostream&>(stream) << value;
+                    return;
+                }
+                char text[MaxNumberSize];
+                stream.append(text, static_cast<std::size_t>(writeInteger(text, value) - text));
+            }
+        };
+
+        template<class T>
+        struct LogFormatter<T, typename std::enable_if<std::is_same<T, float>::value || std::is_same<T, double>::value>::type> {
+            // Text reading back as the value, shortest but in rare cases, not the 6 digits of the streams
+            static void write(LogStream& stream, T value) {
+                if(!stream.hasDefaultFormat()) {
+                    static_cast<std::ostream&>(stream) << value;
+                    return;
+                }
+                char text[MaxNumberSize];
+                stream.append(text, static_cast<std::size_t>(priv_write(text, value) - text));
+            }
+
+        private:
+            // Floats get a text reading back as the same float, not as their double
+            static char* priv_write(char* out, float value) {
+                return writeFloat(out, value);
+            }
+
+            static char* priv_write(char* out, double value) {
+                return writeDouble(out, value);
+            }
+        };
+
+        template<>
+        struct LogFormatter<bool> {
+            static void write(LogStream& stream, bool value) {
+                if(!stream.hasDefaultFormat()) {
+                    static_cast<std::ostream&>(stream) << value;
+                    return;
+                }
+                stream.append(value ? "1" : "0", 1);
+            }
+        };
+
+        template<>
+        struct LogFormatter<char> {
+            static void write(LogStream& stream, char value) {
+                if(stream.width() != 0) {
+                    static_cast<std::ostream&>(stream) << value;
+                    return;
+                }
+                stream.append(&value, 1);
+            }
+        };
+
+        template<>
+        struct LogFormatter<const char*> {
+            static void write(LogStream& stream, const char* value) {
+                if(stream.width() != 0) {
+                    static_cast<std::ostream&>(stream) << value;
+                    return;
+                }
+                if(!value) {
+                    value = "(null)";
+                }
+                stream.append(value, std::strlen(value));
+            }
+        };
+
+        template<>
+        struct LogFormatter<char*>
+            : LogFormatter<const char*> {
+        };
+
+        template<>
+        struct LogFormatter<std::string> {
+            static void write(LogStream& stream, const std::string& value) {
+                if(stream.width() != 0) {
+                    static_cast<std::ostream&>(stream) << value;
+                    return;
+                }
+                stream.append(value.data(), value.size());
+            }
+        };
+
+        // Pointers to objects other than characters, written in hexadecimal
+        template<class T>
+        struct LogFormatter<T*, typename std::enable_if<!std::is_function<T>::value && !std::is_volatile<T>::value &&
+                                                        !std::is_same<typename std::remove_cv<T>::type, char>::value &&
+                                                        !std::is_same<typename std::remove_cv<T>::type, signed char>::value &&
+                                                        !std::is_same<typename std::remove_cv<T>::type, unsigned char>::value>::type> {
+            static void write(LogStream& stream, const void* value) {
+                if(stream.width() != 0) {
+                    static_cast<std::ostream&>(stream) << value;
+                    return;
+                }
+                char text[MaxNumberSize];
+                stream.append(text, static_cast<std::size_t>(writePointer(text, value) - text));
+            }
+        };
+
+        template<class T>
+        void writeArgument(LogStream& stream, const T& value) {
+            LogFormatter<typename std::decay<T>::type>::write(stream, value);
+        }
+
+    }
+
+}
@@ -23,11 +23,173 @@
 #pragma once
 
 #include <rsm/log/log_device.hpp>
+#include <rsm/log/async_log_writer.hpp>
+#include <rsm/log/log_stream.hpp>
+#include <rsm/log/log_site.hpp>
+#include <atomic>
 #include <vector>
 #include <memory>
-#include <sstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+////////////////////////////////////////////////////////////
+/// \brief Minimum level of the RSM_LOG macros, fixed at compile time
+///
+/// The statements of the levels below are removed by the compiler,
+/// arguments included. Uses the values of rsm::LogLevel: 0 for None,
+/// 1 for Debug, 2 for Info, 3 for Warning, 4 for Critical, 5 for Error.
+////////////////////////////////////////////////////////////
+#ifndef RSM_LOG_MIN_LEVEL
+#define RSM_LOG_MIN_LEVEL 0
+#endif
+
+////////////////////////////////////////////////////////////
+/// \brief Log a statement at a level, evaluating the streamed data
+///        only if the level is enabled
+///
+/// RSM_LOG(rsm::LogLevel::Info) << "Expensive " << compute();
+///
+/// Unlike rsm::Logger::info(), compute() is not called when the level
+/// is below RSM_LOG_MIN_LEVEL or the threshold of the logger, or when
+/// the statement exceeds the rate limit set with rsm::Logger::setRateLimit.
+////////////////////////////////////////////////////////////
+#define RSM_LOG(level) \
+    RSM_LOG_IF(level, RSM_LOG_SITE().allowDefault(level))
+
+////////////////////////////////////////////////////////////
+/// \brief Log a statement at most perSecond times per second
+///
+/// RSM_LOG_RATE_LIMITED(rsm::LogLevel::Warning, 10, 100) << "Retrying " << id;
+///
+/// Up to burst records are logged at once after a quiet period. The
+/// number of suppressed records is logged the next time the statement
+/// is, and by rsm::Logger::reportSuppressedRecords.
+////////////////////////////////////////////////////////////
+#define RSM_LOG_RATE_LIMITED(level, perSecond, burst) \
+    RSM_LOG_IF(level, RSM_LOG_SITE().allowRate(level, perSecond, burst))
+
+////////////////////////////////////////////////////////////
+/// \brief Log the first record of a statement, then one every n
+///
+/// RSM_LOG_EVERY_N(rsm::LogLevel::Debug, 1000) << "Received " << packet;
+////////////////////////////////////////////////////////////
+#define RSM_LOG_EVERY_N(level, n) \
+    RSM_LOG_IF(level, RSM_LOG_SITE().sample(n))
+
+// The condition is only evaluated for the enabled levels
+#define RSM_LOG_IF(level, condition) \
+    if(static_cast<int>(level) < RSM_LOG_MIN_LEVEL || !::rsm::Logger::isEnabled(level) || !(condition)) {} \
+    else ::rsm::LogRecordBuilder(level, RSM_LOG_SOURCE_LOCATION)
+
+// Each expansion has its own lambda, so its own state
+#define RSM_LOG_SITE() \
+    ([]() -> ::rsm::detail::LogSite& { static ::rsm::detail::LogSite site(__FILE__, __LINE__); return site; }())
+
+#define RSM_LOG_DEBUG RSM_LOG(::rsm::LogLevel::Debug)
+#define RSM_LOG_INFO RSM_LOG(::rsm::LogLevel::Info)
+#define RSM_LOG_WARNING RSM_LOG(::rsm::LogLevel::Warning)
+#define RSM_LOG_CRITICAL RSM_LOG(::rsm::LogLevel::Critical)
+#define RSM_LOG_ERROR RSM_LOG(::rsm::LogLevel::Error)
+
+////////////////////////////////////////////////////////////
+/// \brief Log a deferred record with the location of the statement,
+///        evaluating the arguments only if the level is enabled
+///
+/// RSM_LOG_DEFERRED(rsm::LogLevel::Info, "Sent {} bytes to {}", size, host);
+////////////////////////////////////////////////////////////
+#define RSM_LOG_DEFERRED(level, ...) \
+    if(static_cast<int>(level) < RSM_LOG_MIN_LEVEL || !::rsm::Logger::isEnabled(level)) {} \
+    else ::rsm::Logger::logDeferred(RSM_LOG_SOURCE_LOCATION, level, __VA_ARGS__)
 
 namespace rsm {
+
+    class LogCategory;
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Accumulates the data streamed in a log statement
+    ///
+    /// Returned by the level functions of the Logger. The whole statement
+    /// is formatted in the buffer of the calling thread and written to the
+    /// devices as a single record when the builder is destroyed, at the
+    /// end of the statement:
+    /// rsm::Logger::info() << "a" << x << "b"; // One record, one line
+    ///
+    /// When the level is disabled, nothing is formatted.
+    ////////////////////////////////////////////////////////////
+    class LogRecordBuilder final {
+    public:
+        explicit LogRecordBuilder(LogLevel level);
+        LogRecordBuilder(LogLevel level, const LogSourceLocation& location);
+        LogRecordBuilder(LogRecordBuilder&& other);
+        ~LogRecordBuilder();
+
+        LogRecordBuilder(const LogRecordBuilder&) = delete;
+        LogRecordBuilder& operator=(const LogRecordBuilder&) = delete;
+        LogRecordBuilder& operator=(LogRecordBuilder&&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Templated stream overload appending data to the record
+        ///
+        /// Numbers, characters, strings and pointers are formatted without
+        /// the stream, the floating point numbers as a text reading back
+        /// as the same value, the shortest one but in rare cases. Other
+        /// types use their operator<<.
+        ///
+        /// \param data The data to log passed in the stream
+        ////////////////////////////////////////////////////////////
+        template<class T>
+        LogRecordBuilder& operator<<(const T& data) {
+            if(m_stream) {
+                detail::writeArgument(*m_stream, data);
+            }
+            return *this;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Stream overload for manipulators like std::hex
+        ///
+        ////////////////////////////////////////////////////////////
+        LogRecordBuilder& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+            if(m_stream) {
+                *m_stream << manipulator;
+            }
+            return *this;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Attach a typed key-value field to the record
+        ///
+        /// rsm::Logger::info().kv("latency_us", latency) << "Request done";
+        ///
+        /// Devices receive the fields typed through logStructured.
+        ///
+        /// \param key Name of the field
+        /// \param value Value of the field, types other than the numbers,
+        ///        characters and strings being formatted with operator<<
+        ////////////////////////////////////////////////////////////
+        template<class T>
+        LogRecordBuilder& kv(const char* key, const T& value) {
+            if(m_stream) {
+                LogFields::encode(m_stream->fields(), key, value);
+            }
+            return *this;
+        }
+
+    private:
+        // Without devices, or when they are empty, the record goes to the devices of the Logger
+        LogRecordBuilder(LogLevel level, bool enabled, const detail::LogDeviceSet* devices, const LogSourceLocation& location);
+
+    private:
+        const detail::LogDeviceSet* m_devices;
+        LogLevel m_level;
+        std::uint64_t m_timestamp;
+        LogSourceLocation m_location;
+        // nullptr when the level is disabled or the builder was moved
+        detail::LogStream* m_stream;
+        std::unique_ptr<detail::LogStream> m_ownStream;
+        friend class LogCategory;
+    };
 	
     ////////////////////////////////////////////////////////////
     /// \brief Logger class to log information with different level
@@ -46,6 +208,24 @@ namespace rsm {
     /// The logger works as a stream system, so it can be used easily
     /// like such:
     /// rsm::Logger::debug() << "Logging data" << myObject;
+    ///
+    /// Every statement produces one record, written to the devices at
+    /// the end of the statement.
+    ///
+    /// Records below the threshold set with setLogLevelThreshold are not
+    /// formatted. The RSM_LOG macros also skip evaluating the streamed
+    /// data and can be removed at compile time with RSM_LOG_MIN_LEVEL.
+    ///
+    /// Logging is thread-safe: every thread formats its records in its
+    /// own buffer and has its own current level. Devices can be added
+    /// and removed while other threads log: a record is written to a
+    /// snapshot of the devices that later calls leave unchanged, and the
+    /// devices of a snapshot live until its last record is written.
+    ///
+    /// After startAsync, logging only copies the record in a lock-free
+    /// queue and a background thread writes it to the devices.
+    /// Devices must not log back into an asynchronous Logger: their
+    /// records are dropped when the queue is full, whatever the policy.
     ////////////////////////////////////////////////////////////
 	class Logger final {
 	public:
@@ -55,10 +235,14 @@ namespace rsm {
         ////////////////////////////////////////////////////////////
         /// \brief Add a logging device for logging
         ///
-        /// \param device A LogDevice::Ptr that will be kept to use for logging
+        /// Can be called while other threads log: the records being
+        /// written keep the devices they started with.
+        ///
+        /// \param device Device that will be kept to use for logging, which
+        ///        can be shared with log categories
         ////////////////////////////////////////////////////////////
-		static void addLogDevice(LogDevice::Ptr device) {
-			loggerImpl().m_logDevices.emplace_back(std::move(device));
+		static void addLogDevice(std::shared_ptr<LogDevice> device) {
+			loggerImpl().m_logDevices.add(std::move(device));
 		}
         
         ////////////////////////////////////////////////////////////
@@ -77,7 +261,7 @@ namespace rsm {
         ////////////////////////////////////////////////////////////
         template<class T>
         static void log(const T& data) {
-            log(loggerImpl().m_currentLevel, data);
+            log(priv_currentLevel(), data);
         }
         
         ////////////////////////////////////////////////////////////
@@ -97,13 +281,50 @@ namespace rsm {
         ////////////////////////////////////////////////////////////
         template<class T>
         static void log(LogLevel level, const T& data) {
-            auto& stream = loggerImpl().m_stream;
-            stream << data;
-            for(auto& device : loggerImpl().m_logDevices) {
-                device->log(level, stream.str());
+            LogRecordBuilder(level) << data;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Log a record formatted later, by the background thread
+        ///        or offline
+        ///
+        /// Only the pointer to the format and the raw bytes of the arguments
+        /// are captured. Integers, floating points, booleans, characters and
+        /// strings are copied as is; other types are formatted right away
+        /// with their operator<<.
+        ///
+        /// rsm::Logger::logDeferred(rsm::LogLevel::Info, "Sent {} bytes to {}", size, host);
+        ///
+        /// \param level Level of logging
+        /// \param format Format with {} placeholders, which must outlive
+        ///        the logger, like a string literal
+        /// \param args Arguments replacing the placeholders
+        ///
+        /// \see startAsync
+        /// \see BinaryFileLogDevice
+        ////////////////////////////////////////////////////////////
+        template<class... Args>
+        static void logDeferred(LogLevel level, const char* format, const Args&... args) {
+            if(isEnabled(level)) {
+                priv_logDeferred(nullptr, LogSourceLocation{ nullptr, 0, nullptr }, level, format, args...);
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Log a record formatted later, with the location of the
+        ///        statement, as written by RSM_LOG_DEFERRED
+        ///
+        /// \param location Location of the statement
+        /// \param level Level of logging
+        /// \param format Format with {} placeholders, which must outlive
+        ///        the logger, like a string literal
+        /// \param args Arguments replacing the placeholders
+        ////////////////////////////////////////////////////////////
+        template<class... Args>
+        static void logDeferred(const LogSourceLocation& location, LogLevel level, const char* format, const Args&... args) {
+            if(isEnabled(level)) {
+                priv_logDeferred(nullptr, location, level, format, args...);
             }
-            stream.str("");
-            stream.clear();
         }
 
         ////////////////////////////////////////////////////////////
@@ -111,11 +332,11 @@ namespace rsm {
         ///
         /// Log the data given in the stream at debug level.
         ///
-        /// \return A logger implementation to use with streaming
+        /// \return A record builder to use with streaming
         ////////////////////////////////////////////////////////////
-		static Logger& debug() {
+		static LogRecordBuilder debug() {
             setCurrentLogLevel(LogLevel::Debug);
-            return loggerImpl();
+            return LogRecordBuilder(LogLevel::Debug);
 		}
 
         ////////////////////////////////////////////////////////////
@@ -123,11 +344,11 @@ namespace rsm {
         ///
         /// Log the data given in the stream at info level.
         ///
-        /// \return A logger implementation to use with streaming
+        /// \return A record builder to use with streaming
         ////////////////////////////////////////////////////////////
-		static Logger& info() {
+		static LogRecordBuilder info() {
             setCurrentLogLevel(LogLevel::Info);
-            return loggerImpl();
+            return LogRecordBuilder(LogLevel::Info);
 		}
 
         ////////////////////////////////////////////////////////////
@@ -135,11 +356,11 @@ namespace rsm {
         ///
         /// Log the data given in the stream at warning level.
         ///
-        /// \return A logger implementation to use with streaming
+        /// \return A record builder to use with streaming
         ////////////////////////////////////////////////////////////
-		static Logger& warning() {
+		static LogRecordBuilder warning() {
             setCurrentLogLevel(LogLevel::Warning);
-            return loggerImpl();
+            return LogRecordBuilder(LogLevel::Warning);
 		}
 
         ////////////////////////////////////////////////////////////
@@ -147,11 +368,11 @@ namespace rsm {
         ///
         /// Log the data given in the stream at critical level.
         ///
-        /// \return A logger implementation to use with streaming
+        /// \return A record builder to use with streaming
         ////////////////////////////////////////////////////////////
-		static Logger& critical() {
+		static LogRecordBuilder critical() {
             setCurrentLogLevel(LogLevel::Critical);
-            return loggerImpl();
+            return LogRecordBuilder(LogLevel::Critical);
 		}
 
         ////////////////////////////////////////////////////////////
@@ -159,36 +380,168 @@ namespace rsm {
         ///
         /// Log the data given in the stream at error level.
         ///
-        /// \return A logger implementation to use with streaming
+        /// \return A record builder to use with streaming
         ////////////////////////////////////////////////////////////
-		static Logger& error() {
+		static LogRecordBuilder error() {
             setCurrentLogLevel(LogLevel::Error);
-            return loggerImpl();
+            return LogRecordBuilder(LogLevel::Error);
 		}
 
         ////////////////////////////////////////////////////////////
         /// \brief Remove all log devices previously registered
         ///
+        /// The queued records are written first. Other threads can keep
+        /// logging: the records being written finish with the previous
+        /// devices, which are destroyed after the last of them.
         ////////////////////////////////////////////////////////////
 		static void resetLogDevices() {
-			loggerImpl().m_logDevices.clear();
+			auto& logger = loggerImpl();
+			if(const auto writer = logger.priv_asyncWriter()) {
+				writer->flush();
+			}
+			logger.m_logDevices.clear();
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write the records to the devices on a background thread
+        ///
+        /// Does nothing if the logger is already asynchronous. Can be
+        /// called while other threads log.
+        ///
+        /// \param capacity Number of records the queue can hold
+        /// \param policy What to do when the queue is full: wait for
+        ///        a free slot, or drop the record and count it
+        ///
+        /// \throw std::logic_error if called from a device of an
+        ///        asynchronous Logger
+        ///
+        /// \see stopAsync
+        /// \see getDroppedCount
+        ////////////////////////////////////////////////////////////
+		static void startAsync(std::size_t capacity = 8192, LogOverflowPolicy policy = LogOverflowPolicy::Block) {
+			priv_checkNotWriterThread();
+			auto& logger = loggerImpl();
+			std::lock_guard<std::mutex> lock(logger.m_asyncMutex);
+			if(logger.priv_asyncWriter()) {
+				return;
+			}
+			logger.m_asyncCapacity = capacity;
+			logger.m_overflowPolicy = policy;
+			logger.priv_resumeAsync();
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write the queued records, then log synchronously again
+        ///
+        /// Can be called while other threads log: their records are
+        /// queued or written directly. Called when the program exits if
+        /// the logger is still asynchronous.
+        ///
+        /// \throw std::logic_error if called from a device of an
+        ///        asynchronous Logger, which would wait for itself
+        ////////////////////////////////////////////////////////////
+		static void stopAsync() {
+			priv_checkNotWriterThread();
+			auto& logger = loggerImpl();
+			std::lock_guard<std::mutex> lock(logger.m_asyncMutex);
+			logger.priv_pauseAsync();
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Wait until every record logged so far is written and
+        ///        flush the devices
+        ///
+        /// Reports the records suppressed by the rate limits first. From a
+        /// device of an asynchronous Logger, only flushes the devices.
+        ////////////////////////////////////////////////////////////
+		static void flush() {
+			reportSuppressedRecords();
+			auto& logger = loggerImpl();
+			if(const auto writer = logger.priv_asyncWriter()) {
+				writer->flush();
+			} else {
+				for(auto& device : *logger.m_logDevices.load()) {
+					device->flush();
+				}
+			}
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the number of records dropped because the queue was full
+        ///
+        /// \return The number of dropped records since the program started
+        ////////////////////////////////////////////////////////////
+		static std::size_t getDroppedCount() {
+			return loggerImpl().m_droppedCount.load(std::memory_order_relaxed);
 		}
         
         ////////////////////////////////////////////////////////////
-        /// \brief Templated stream overload for passing data to the logger
+        /// \brief Set the minimum level of the logged records
         ///
-        /// \param data The data to log passed in the stream
+        /// Applies to every thread. Records below it are dropped before
+        /// being formatted.
+        ///
+        /// \param level Minimum log level, LogLevel::None to log everything
         ////////////////////////////////////////////////////////////
-        template<class T>
-        Logger& operator<<(const T& data) const
-        {
-            auto& logger = loggerImpl();
-            logger.log(data);
-            return logger;
+        static void setLogLevelThreshold(LogLevel level) {
+            priv_threshold().store(level, std::memory_order_relaxed);
         }
-        
+
         ////////////////////////////////////////////////////////////
-        /// \brief Set the current log level of the logger
+        /// \brief Return the minimum level of the logged records
+        ///
+        /// \return The minimum log level
+        ////////////////////////////////////////////////////////////
+        static LogLevel getLogLevelThreshold() {
+            return priv_threshold().load(std::memory_order_relaxed);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Tell if the records of a level are logged
+        ///
+        /// \param level Log level to check
+        ///
+        /// \return true if the level is at least the threshold
+        ////////////////////////////////////////////////////////////
+        static bool isEnabled(LogLevel level) {
+            return level >= getLogLevelThreshold();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Limit the number of records each statement of the
+        ///        RSM_LOG macros logs per second
+        ///
+        /// The records over the limit are dropped before being formatted,
+        /// and their number is reported in a record once the statement
+        /// logs again, or when reportSuppressedRecords is called. The
+        /// numbers of all the statements are also reported every second
+        /// while rate limited statements are checked.
+        ///
+        /// \param perSecond Number of records allowed per second and per
+        ///        statement, 0 to remove the limit
+        /// \param burst Number of records allowed at once after a quiet period
+        ////////////////////////////////////////////////////////////
+        static void setRateLimit(double perSecond, std::uint32_t burst = 1) {
+            detail::LogSite::setDefaultRate(perSecond, burst);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Log the number of records each rate limited statement
+        ///        suppressed since its last report
+        ///
+        /// Called every second while rate limited statements are
+        /// checked, and by flush. Call it periodically to get the reports
+        /// of the statements that stopped logging when no other rate
+        /// limited statement runs.
+        ////////////////////////////////////////////////////////////
+        static void reportSuppressedRecords() {
+            detail::LogSite::forEachSuppressing([](detail::LogSite& site) {
+                priv_writeSuppressed(site);
+            });
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the current log level of the logger for the calling thread
         ///
         /// While this function can be used with log, the level functions are more intuitive
         /// and easy to use.
@@ -201,19 +554,253 @@ namespace rsm {
         /// \see error
         ////////////////////////////////////////////////////////////
         static void setCurrentLogLevel(LogLevel level) {
-            loggerImpl().m_currentLevel = level;
+            priv_currentLevel() = level;
         }
         
 	private:
-		Logger() = default;
+		Logger()
+			: m_asyncCapacity(0)
+			, m_overflowPolicy(LogOverflowPolicy::Block)
+			, m_droppedCount(0) {
+		}
+
+		~Logger() {
+			priv_pauseAsync();
+		}
+
+		// Null when the logger is synchronous. The writer is kept alive
+		// while the caller holds it, even if another thread stops it.
+		std::shared_ptr<detail::AsyncLogWriter> priv_asyncWriter() const {
+			return std::atomic_load_explicit(&m_asyncWriter, std::memory_order_acquire);
+		}
+
+		// Writes the queued records and stops the background thread.
+		// Returns false if the logger was already synchronous.
+		bool priv_pauseAsync() {
+			auto writer = std::atomic_exchange_explicit(&m_asyncWriter, std::shared_ptr<detail::AsyncLogWriter>(), std::memory_order_acq_rel);
+			if(!writer) {
+				return false;
+			}
+			// Waits for the threads still pushing to the writer, so that the
+			// background thread is never joined by one of its own records.
+			// Pushes end while the background thread runs: it never blocks
+			// on a full queue, and the other threads wait for it
+			while(writer.use_count() > 1) {
+				std::this_thread::yield();
+			}
+			writer.reset();
+			return true;
+		}
+
+		void priv_resumeAsync() {
+			std::atomic_store_explicit(&m_asyncWriter,
+			                           std::make_shared<detail::AsyncLogWriter>(m_logDevices, m_asyncCapacity, m_overflowPolicy, m_droppedCount),
+			                           std::memory_order_release);
+		}
+
+		// The background thread would wait for the mutex held by the thread joining it
+		static void priv_checkNotWriterThread() {
+			if(detail::AsyncLogWriter::onWriterThread()) {
+				throw std::logic_error("The asynchronous logger can not be started or stopped from a log device");
+			}
+		}
+
+		// Constant initialized, so reading it needs no guard
+		static std::atomic<LogLevel>& priv_threshold() {
+			static std::atomic<LogLevel> threshold{LogLevel::None};
+			return threshold;
+		}
+
+		static LogLevel& priv_currentLevel() {
+			thread_local LogLevel level = LogLevel::None;
+			return level;
+		}
+
+		// Returns nullptr when the stream of the thread is used by a record
+		// being built, when the data streamed in a record logs itself
+		static detail::LogStream* priv_claimThreadStream() {
+			thread_local detail::LogStream stream;
+			if(priv_threadStreamClaimed()) {
+				return nullptr;
+			}
+			priv_threadStreamClaimed() = true;
+			stream.reset();
+			return &stream;
+		}
+
+		static void priv_releaseThreadStream() {
+			priv_threadStreamClaimed() = false;
+		}
+
+		static bool& priv_threadStreamClaimed() {
+			thread_local bool claimed = false;
+			return claimed;
+		}
+
+		static bool& priv_threadArgumentsClaimed() {
+			thread_local bool claimed = false;
+			return claimed;
+		}
+
+		template<class... Args>
+		static void priv_logDeferred(const detail::LogDeviceSet* devices, const LogSourceLocation& location, LogLevel level,
+		                             const char* format, const Args&... args) {
+			// The arguments formatted with operator<< may log deferred records themselves
+			bool& claimed = priv_threadArgumentsClaimed();
+			if(claimed) {
+				std::string arguments;
+				DeferredLogRecord::encode(arguments, args...);
+				priv_writeDeferred(devices, level, LogClock::now(), location, format, arguments);
+				return;
+			}
+			const std::uint64_t timestamp = LogClock::now();
+			thread_local std::string arguments;
+			claimed = true;
+			arguments.clear();
+			DeferredLogRecord::encode(arguments, args...);
+			claimed = false;
+			priv_writeDeferred(devices, level, timestamp, location, format, arguments);
+		}
+
+		// Without devices, or when they are empty, the records go to the devices of the logger
+		static detail::LogDeviceSet::Snapshot priv_devices(const detail::LogDeviceSet* devices) {
+			if(devices) {
+				detail::LogDeviceSet::Snapshot snapshot = devices->load();
+				if(!snapshot->empty()) {
+					return snapshot;
+				}
+			}
+			return loggerImpl().m_logDevices.load();
+		}
+
+		static void priv_writeDeferred(const detail::LogDeviceSet* devices, LogLevel level, std::uint64_t timestamp, const LogSourceLocation& location,
+		                               const char* format, const std::string& arguments) {
+			if(const auto writer = loggerImpl().priv_asyncWriter()) {
+				writer->pushDeferred(devices, level, timestamp, location, format, arguments);
+			} else {
+				const detail::RecordTimestampScope timestampScope(timestamp);
+				const detail::RecordLocationScope locationScope(location);
+				const DeferredLogRecord record(format, arguments.data(), arguments.size());
+				for(auto& device : *priv_devices(devices)) {
+					if(device->isEnabled(level)) {
+						device->logDeferred(level, record);
+					}
+				}
+			}
+		}
+
+		static void priv_writeStructured(const detail::LogDeviceSet* devices, LogLevel level, std::uint64_t timestamp, const LogSourceLocation& location,
+		                                 const std::string& message, const std::string& fields) {
+			if(const auto writer = loggerImpl().priv_asyncWriter()) {
+				writer->pushStructured(devices, level, timestamp, location, message, fields);
+			} else {
+				const detail::RecordTimestampScope timestampScope(timestamp);
+				const detail::RecordLocationScope locationScope(location);
+				const LogFields recordFields(fields.data(), fields.size());
+				for(auto& device : *priv_devices(devices)) {
+					if(device->isEnabled(level)) {
+						device->logStructured(level, message, recordFields);
+					}
+				}
+			}
+		}
+
+		static void priv_write(const detail::LogDeviceSet* devices, LogLevel level, std::uint64_t timestamp, const LogSourceLocation& location,
+		                       const std::string& message) {
+			if(const auto writer = loggerImpl().priv_asyncWriter()) {
+				writer->push(devices, level, timestamp, location, message);
+			} else {
+				const detail::RecordTimestampScope timestampScope(timestamp);
+				const detail::RecordLocationScope locationScope(location);
+				for(auto& device : *priv_devices(devices)) {
+					if(device->isEnabled(level)) {
+						device->log(level, message);
+					}
+				}
+			}
+		}
+
+		static void priv_writeSuppressed(detail::LogSite& site) {
+			const std::uint64_t suppressed = site.takeSuppressed();
+			if(suppressed != 0) {
+				const LogLevel level = site.getLevel();
+				LogRecordBuilder(level) << "Suppressed " << suppressed << " records at " << site.getFile() << ':' << site.getLine();
+			}
+		}
+
 		static Logger& loggerImpl() {
 			static Logger logger;
 			return logger;
 		}
 
     private:
-		std::vector<LogDevice::Ptr> m_logDevices;
-        std::ostringstream m_stream;
-        LogLevel m_currentLevel;
+		detail::LogDeviceSet m_logDevices;
+        std::size_t m_asyncCapacity;
+        LogOverflowPolicy m_overflowPolicy;
+        std::atomic<std::size_t> m_droppedCount;
+        // Read without lock by the logging threads, changed under m_asyncMutex
+        std::shared_ptr<detail::AsyncLogWriter> m_asyncWriter;
+        std::mutex m_asyncMutex;
+
+        friend class LogRecordBuilder;
+        friend class LogCategory;
+        friend class detail::LogSite;
 	};
+
+    inline LogRecordBuilder::LogRecordBuilder(LogLevel level)
+        : LogRecordBuilder(level, Logger::isEnabled(level), nullptr, LogSourceLocation{ nullptr, 0, nullptr }) {
+    }
+
+    inline LogRecordBuilder::LogRecordBuilder(LogLevel level, const LogSourceLocation& location)
+        : LogRecordBuilder(level, Logger::isEnabled(level), nullptr, location) {
+    }
+
+    inline LogRecordBuilder::LogRecordBuilder(LogLevel level, bool enabled, const detail::LogDeviceSet* devices, const LogSourceLocation& location)
+        : m_devices(devices)
+        , m_level(level)
+        , m_timestamp(0)
+        , m_location(location)
+        , m_stream(nullptr) {
+        if(!enabled) {
+            return;
+        }
+        m_timestamp = LogClock::now();
+        m_stream = Logger::priv_claimThreadStream();
+        if(!m_stream) {
+            m_ownStream.reset(new detail::LogStream());
+            m_stream = m_ownStream.get();
+        }
+    }
+
+    inline LogRecordBuilder::LogRecordBuilder(LogRecordBuilder&& other)
+        : m_devices(other.m_devices)
+        , m_level(other.m_level)
+        , m_timestamp(other.m_timestamp)
+        , m_location(other.m_location)
+        , m_stream(other.m_stream)
+        , m_ownStream(std::move(other.m_ownStream)) {
+        other.m_stream = nullptr;
+    }
+
+    inline LogRecordBuilder::~LogRecordBuilder() {
+        if(!m_stream) {
+            return;
+        }
+        if(m_stream->fields().empty()) {
+            Logger::priv_write(m_devices, m_level, m_timestamp, m_location, m_stream->str());
+        } else {
+            Logger::priv_writeStructured(m_devices, m_level, m_timestamp, m_location, m_stream->str(), m_stream->fields());
+        }
+        if(!m_ownStream) {
+            Logger::priv_releaseThreadStream();
+        }
+    }
+
+    inline void detail::LogSite::priv_reportSuppressed() {
+        Logger::priv_writeSuppressed(*this);
+    }
+
+    inline void detail::LogSite::priv_reportAll() {
+        Logger::reportSuppressedRecords();
+    }
 }
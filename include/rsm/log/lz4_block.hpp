@@ -0,0 +1,227 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Compression of independent blocks in the LZ4 block format
+        ///
+        /// A block is a list of sequences: a token giving the lengths of
+        /// the literals and of the match, the literals, the offset of the
+        /// match in the previous 64KiB (little endian uint16) and the rest
+        /// of the lengths, in bytes of 255. The last sequence only has
+        /// literals, at least 5 of them. Blocks written here can be read
+        /// by any LZ4 block decoder.
+        ////////////////////////////////////////////////////////////
+        namespace lz4 {
+
+            constexpr std::size_t MinMatch = 4;
+            constexpr std::size_t LastLiterals = 5;
+            // No match starts in the last 12 bytes
+            constexpr std::size_t MatchFindLimit = 12;
+            constexpr std::size_t MaxOffset = 65535;
+            constexpr unsigned HashLog = 12;
+
+            // Largest size of the compressed data of size bytes
+            inline std::size_t compressBound(std::size_t size) {
+                return size + size / 255 + 16;
+            }
+
+            inline std::uint32_t read32(const unsigned char* data) {
+                std::uint32_t value;
+                std::memcpy(&value, data, sizeof(value));
+                return value;
+            }
+
+            inline unsigned char* writeLength(unsigned char* out, std::size_t length) {
+                while(length >= 255) {
+                    *out++ = 255;
+                    length -= 255;
+                }
+                *out++ = static_cast<unsigned char>(length);
+                return out;
+            }
+
+            inline unsigned char* writeSequence(unsigned char* out, const unsigned char* literals, std::size_t literalLength,
+                                                std::size_t offset, std::size_t matchLength) {
+                unsigned char* token = out++;
+                *token = static_cast<unsigned char>((literalLength < 15 ? literalLength : 15) << 4);
+                if(literalLength >= 15) {
+                    out = writeLength(out, literalLength - 15);
+                }
+                std::memcpy(out, literals, literalLength);
+                out += literalLength;
+                if(matchLength == 0) {
+                    return out;
+                }
+                *out++ = static_cast<unsigned char>(offset);
+                *out++ = static_cast<unsigned char>(offset >> 8);
+                const std::size_t length = matchLength - MinMatch;
+                *token |= static_cast<unsigned char>(length < 15 ? length : 15);
+                if(length >= 15) {
+                    out = writeLength(out, length - 15);
+                }
+                return out;
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Decompress a block
+            ///
+            /// \param data Compressed block
+            /// \param size Size of the compressed block
+            /// \param out Receives the decompressed data
+            /// \param outSize Size of the decompressed data
+            ///
+            /// \return false if the block is malformed or does not
+            ///         decompress to exactly outSize bytes
+            ////////////////////////////////////////////////////////////
+            inline bool decompress(const char* data, std::size_t size, char* out, std::size_t outSize) {
+                const auto* in = reinterpret_cast<const unsigned char*>(data);
+                std::size_t position = 0;
+                std::size_t written = 0;
+                const auto readLength = [&](std::size_t& length) {
+                    unsigned char byte;
+                    do {
+                        if(position >= size) {
+                            return false;
+                        }
+                        byte = in[position++];
+                        length += byte;
+                    } while(byte == 255);
+                    return true;
+                };
+
+                while(position < size) {
+                    const unsigned char token = in[position++];
+                    std::size_t literalLength = token >> 4;
+                    if(literalLength == 15 && !readLength(literalLength)) {
+                        return false;
+                    }
+                    if(literalLength > size - position || literalLength > outSize - written) {
+                        return false;
+                    }
+                    std::memcpy(out + written, in + position, literalLength);
+                    position += literalLength;
+                    written += literalLength;
+                    if(position == size) {
+                        break;
+                    }
+
+                    if(size - position < 2) {
+                        return false;
+                    }
+                    const std::size_t offset = in[position] | (static_cast<std::size_t>(in[position + 1]) << 8);
+                    position += 2;
+                    std::size_t matchLength = token & 15;
+                    if(matchLength == 15 && !readLength(matchLength)) {
+                        return false;
+                    }
+                    matchLength += MinMatch;
+                    if(offset == 0 || offset > written || matchLength > outSize - written) {
+                        return false;
+                    }
+                    // The match can overlap the bytes it writes
+                    const char* match = out + written - offset;
+                    for(std::size_t i = 0; i < matchLength; ++i) {
+                        out[written + i] = match[i];
+                    }
+                    written += matchLength;
+                }
+                return written == outSize;
+            }
+
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Compresses blocks in the LZ4 block format
+        ///
+        /// Greedy matching on a hash of the next four bytes, reusing
+        /// its table from one block to the next.
+        ////////////////////////////////////////////////////////////
+        class Lz4Compressor final {
+        public:
+            Lz4Compressor()
+                : m_table(std::size_t(1) << lz4::HashLog) {
+            }
+
+            ////////////////////////////////////////////////////////////
+            /// \brief Compress a block
+            ///
+            /// \param data Data to compress
+            /// \param size Size of the data
+            /// \param out Buffer of at least lz4::compressBound(size) bytes
+            ///
+            /// \return The size of the compressed block
+            ////////////////////////////////////////////////////////////
+            std::size_t compress(const char* data, std::size_t size, char* out) {
+                using namespace lz4;
+                const auto* in = reinterpret_cast<const unsigned char*>(data);
+                auto* output = reinterpret_cast<unsigned char*>(out);
+                std::size_t anchor = 0;
+
+                if(size > MatchFindLimit) {
+                    // Positions are stored plus one, zero being an empty entry
+                    std::fill(m_table.begin(), m_table.end(), 0);
+                    const std::size_t matchLimit = size - LastLiterals;
+                    std::size_t position = 0;
+                    while(position < size - MatchFindLimit) {
+                        const std::uint32_t sequence = read32(in + position);
+                        const std::uint32_t hash = (sequence * 2654435761u) >> (32 - HashLog);
+                        const std::size_t candidate = m_table[hash];
+                        m_table[hash] = static_cast<std::uint32_t>(position + 1);
+                        if(candidate == 0 || position + 1 - candidate > MaxOffset || read32(in + candidate - 1) != sequence) {
+                            // Skips faster through data without matches
+                            position += 1 + ((position - anchor) >> 6);
+                            continue;
+                        }
+                        const std::size_t match = candidate - 1;
+                        std::size_t length = MinMatch;
+                        while(position + length < matchLimit && in[match + length] == in[position + length]) {
+                            ++length;
+                        }
+                        output = writeSequence(output, in + anchor, position - anchor, position - match, length);
+                        position += length;
+                        anchor = position;
+                    }
+                }
+
+                output = writeSequence(output, in + anchor, size - anchor, 0, 0);
+                return static_cast<std::size_t>(output - reinterpret_cast<unsigned char*>(out));
+            }
+
+        private:
+            std::vector<std::uint32_t> m_table;
+        };
+
+    }
+
+}
@@ -0,0 +1,219 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define RSM_MAPPED_LOG_SUPPORTED
+#endif
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Layout of the files written by MappedFileLogDevice
+        ///
+        /// The file starts with the magic header, followed by records
+        /// aligned on 4 bytes:
+        ///     - size of the header and the message (uint32)
+        ///     - checksum of the level and the message (uint32)
+        ///     - level (uint32)
+        ///     - message, padded to a multiple of 4 bytes
+        ///
+        /// The size is written last. The unused end of the file is
+        /// zeroed, so a zero size ends the records, and a checksum
+        /// mismatch marks a record cut by a crash.
+        ////////////////////////////////////////////////////////////
+        namespace mapped_log {
+
+            constexpr std::size_t MagicSize = 8;
+            constexpr std::size_t HeaderSize = 12;
+
+            inline const char* magic() {
+                return "RSMMLOG1";
+            }
+
+            inline std::size_t paddedSize(std::size_t size) {
+                return (size + 3) & ~static_cast<std::size_t>(3);
+            }
+
+            // FNV-1a
+            inline std::uint32_t checksum(std::uint32_t level, const char* data, std::size_t size) {
+                std::uint32_t hash = 2166136261u;
+                const auto add = [&hash](unsigned char byte) {
+                    hash ^= byte;
+                    hash *= 16777619u;
+                };
+                for(int shift = 0; shift < 32; shift += 8) {
+                    add(static_cast<unsigned char>(level >> shift));
+                }
+                for(std::size_t i = 0; i < size; ++i) {
+                    add(static_cast<unsigned char>(data[i]));
+                }
+                return hash;
+            }
+
+        }
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log device writing the records in a memory-mapped file
+    ///
+    /// Logging a record is a copy in the mapping, without system call.
+    /// The file grows by large chunks, remapped when the current one is
+    /// full, and is truncated to its content when the device is
+    /// destroyed. Everything copied before the process crashes is kept
+    /// by the system and can be read back with MappedLogReader.
+    ///
+    /// Only available on POSIX systems.
+    ////////////////////////////////////////////////////////////
+	class MappedFileLogDevice final
+		: public LogDevice {
+
+	public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// Creates the log file, truncating it if it already exists.
+        ///
+        /// \param fileName Path to the log file
+        /// \param chunkSize Number of bytes the file grows by
+        ///
+        /// \throw std::runtime_error if the file can not be created or
+        ///        mapped
+        ////////////////////////////////////////////////////////////
+		MappedFileLogDevice(const std::string& fileName, std::size_t chunkSize = 64 * 1024 * 1024)
+			: m_chunkSize(chunkSize < 4096 ? 4096 : chunkSize) {
+#if defined(RSM_MAPPED_LOG_SUPPORTED)
+			m_descriptor = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if(m_descriptor < 0) {
+				throw std::runtime_error("Impossible to create the log file");
+			}
+			if(!priv_grow(detail::mapped_log::MagicSize)) {
+				::close(m_descriptor);
+				throw std::runtime_error("Impossible to map the log file");
+			}
+			std::memcpy(m_mapping, detail::mapped_log::magic(), detail::mapped_log::MagicSize);
+			m_used = detail::mapped_log::MagicSize;
+#else
+			throw std::runtime_error("Memory-mapped log files are not supported on this platform");
+#endif
+		}
+
+		~MappedFileLogDevice() {
+#if defined(RSM_MAPPED_LOG_SUPPORTED)
+			if(m_mapping) {
+				::munmap(m_mapping, m_size);
+			}
+			// On failure the zeroed end stays, which the readers ignore
+			const int truncated = ::ftruncate(m_descriptor, static_cast<off_t>(m_used));
+			static_cast<void>(truncated);
+			::close(m_descriptor);
+#endif
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that copies the record in the mapping
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        ////////////////////////////////////////////////////////////
+		void log(LogLevel level, const std::string& message) override {
+#if defined(RSM_MAPPED_LOG_SUPPORTED)
+			using namespace detail::mapped_log;
+			const auto rawLevel = static_cast<std::uint32_t>(level);
+			const auto recordSize = static_cast<std::uint32_t>(HeaderSize + message.size());
+			const std::uint32_t sum = checksum(rawLevel, message.data(), message.size());
+			const std::size_t size = HeaderSize + paddedSize(message.size());
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(m_used + size > m_size && !priv_grow(size)) {
+				return;
+			}
+			char* record = m_mapping + m_used;
+			std::memcpy(record + 4, &sum, 4);
+			std::memcpy(record + 8, &rawLevel, 4);
+			std::memcpy(record + HeaderSize, message.data(), message.size());
+			// The size makes the record visible, so it must land after the rest
+			std::atomic_signal_fence(std::memory_order_release);
+			std::memcpy(record, &recordSize, 4);
+			m_used += size;
+#endif
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes the mapping to the disk
+        ///
+        /// Only needed to survive a crash of the system, the records
+        /// surviving a crash of the process without it.
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+#if defined(RSM_MAPPED_LOG_SUPPORTED)
+			std::lock_guard<std::mutex> lock(m_mutex);
+			::msync(m_mapping, m_used, MS_SYNC);
+#endif
+		}
+
+	private:
+#if defined(RSM_MAPPED_LOG_SUPPORTED)
+		// Extends the file by at least size bytes and maps it again
+		bool priv_grow(std::size_t size) {
+			const std::size_t newSize = m_size + (size > m_chunkSize ? detail::mapped_log::paddedSize(size) : m_chunkSize);
+			if(::ftruncate(m_descriptor, static_cast<off_t>(newSize)) != 0) {
+				return false;
+			}
+			void* mapping = ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_descriptor, 0);
+			if(mapping == MAP_FAILED) {
+				return false;
+			}
+			if(m_mapping) {
+				::munmap(m_mapping, m_size);
+			}
+			m_mapping = static_cast<char*>(mapping);
+			m_size = newSize;
+			return true;
+		}
+#endif
+
+	private:
+		std::size_t m_chunkSize;
+		std::mutex m_mutex;
+		int m_descriptor = -1;
+		char* m_mapping = nullptr;
+		std::size_t m_size = 0;
+		std::size_t m_used = 0;
+	};
+
+}
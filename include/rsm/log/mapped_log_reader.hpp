@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/mapped_file_log_device.hpp>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Reads the records of a file written by MappedFileLogDevice
+    ///
+    /// Stops at the end of the records, or at the first record cut by a
+    /// crash, so every record completely written before it is recovered.
+    /// rsm::MappedLogReader reader("trace.log");
+    /// rsm::LogLevel level;
+    /// std::string message;
+    /// while(reader.next(level, message)) {
+    ///     //...
+    /// }
+    ////////////////////////////////////////////////////////////
+    class MappedLogReader final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// \param fileName Path to the log file
+        ///
+        /// \throw std::runtime_error if the file can not be opened or
+        ///        was not written by MappedFileLogDevice
+        ////////////////////////////////////////////////////////////
+        MappedLogReader(const std::string& fileName) {
+            m_file.open(fileName, std::ios::in | std::ios::binary);
+            if(!m_file.is_open()) {
+                throw std::runtime_error("Impossible to open the log file");
+            }
+            m_file.seekg(0, std::ios::end);
+            m_fileSize = static_cast<std::size_t>(m_file.tellg());
+            m_file.seekg(0, std::ios::beg);
+            char magic[detail::mapped_log::MagicSize];
+            if(!m_file.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != detail::mapped_log::magic()) {
+                throw std::runtime_error("Not a memory-mapped log file");
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Read the next record
+        ///
+        /// \param level Receives the log level of the record
+        /// \param message Receives the text of the record
+        ///
+        /// \return false when there are no more complete records
+        ////////////////////////////////////////////////////////////
+        bool next(LogLevel& level, std::string& message) {
+            using namespace detail::mapped_log;
+            if(m_done) {
+                return false;
+            }
+
+            std::uint32_t header[3];
+            const auto position = static_cast<std::size_t>(m_file.tellg());
+            if(!m_file.read(reinterpret_cast<char*>(header), HeaderSize) || header[0] < HeaderSize) {
+                return priv_stop();
+            }
+            const std::size_t length = header[0] - HeaderSize;
+            const std::size_t padded = paddedSize(length);
+            if(padded > m_fileSize - position - HeaderSize) {
+                return priv_stop();
+            }
+            message.resize(padded);
+            if(padded > 0 && !m_file.read(&message[0], static_cast<std::streamsize>(padded))) {
+                return priv_stop();
+            }
+            message.resize(length);
+            if(checksum(header[2], message.data(), message.size()) != header[1]) {
+                return priv_stop();
+            }
+            level = static_cast<LogLevel>(header[2]);
+            return true;
+        }
+
+    private:
+        bool priv_stop() {
+            m_done = true;
+            return false;
+        }
+
+    private:
+        std::ifstream m_file;
+        std::size_t m_fileSize = 0;
+        bool m_done = false;
+    };
+
+}
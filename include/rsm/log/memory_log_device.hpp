@@ -0,0 +1,368 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <rsm/log/log_clock.hpp>
+#include <rsm/log/log_file.hpp>
+#include <rsm/log/log_rotation.hpp>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief How many records a MemoryLogDevice keeps, and when it
+    ///        writes them
+    ///
+    /// All the memory is allocated when the device is created:
+    /// buffers * records * recordSize bytes for the records.
+    ////////////////////////////////////////////////////////////
+    struct MemoryLogPolicy {
+        /// Number of ring buffers, the threads being spread over them.
+        /// Threads share a buffer when there are more of them than
+        /// buffers: a record is then dropped if a thread lapped by the
+        /// buffer is still writing in its slot.
+        std::size_t buffers = 16;
+        /// Number of records kept by each buffer
+        std::size_t records = 1024;
+        /// Maximum size of a record, prefix and end of line included.
+        /// Longer records are truncated.
+        std::size_t recordSize = 256;
+        /// Dump the records after logging a record of this level or
+        /// above. LogLevel::None only dumps on demand.
+        LogLevel dumpLevel = LogLevel::Error;
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log device keeping the last records in memory, written to
+    ///        a file only when something goes wrong
+    ///
+    /// Logging a record is a copy in a preallocated ring buffer of the
+    /// calling thread, without lock nor system call, so verbose levels
+    /// can stay enabled. The records are written, oldest first, when
+    /// dump is called, after a record of the dump level, or when the
+    /// process receives a fatal signal once dumpOnFatalSignals is
+    /// called. Each record is written once.
+    ///
+    /// Dumping only uses async-signal-safe calls on POSIX systems.
+    ////////////////////////////////////////////////////////////
+	class MemoryLogDevice final
+		: public LogDevice {
+
+	public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with the filename of the dumps
+        ///
+        /// \param fileName Path to the file the records are dumped in
+        /// \param policy Number and size of the kept records, and the
+        ///        level triggering a dump
+        /// \param mode Truncate or append to an existing file
+        ///
+        /// \throw std::runtime_error if the file can not be created
+        ////////////////////////////////////////////////////////////
+		MemoryLogDevice(const std::string& fileName, const MemoryLogPolicy& policy = MemoryLogPolicy(),
+		                LogFileMode mode = LogFileMode::Truncate)
+			: m_policy(policy)
+			, m_rings(policy.buffers > 0 ? policy.buffers : 1)
+			, m_dumping(false) {
+			m_policy.buffers = m_rings.size();
+			if(m_policy.records == 0) {
+				m_policy.records = 1;
+			}
+			if(m_policy.recordSize < 2) {
+				m_policy.recordSize = 2;
+			}
+			if(!m_file.open(fileName, mode == LogFileMode::Append)) {
+				throw std::runtime_error("Impossible to create the log file");
+			}
+			for(auto& ring : m_rings) {
+				ring.slots.reset(new Slot[m_policy.records]);
+				ring.data.reset(new char[m_policy.records * m_policy.recordSize]);
+			}
+			m_cursors.resize(m_rings.size());
+			m_record.reset(new char[m_policy.recordSize]);
+		}
+
+		~MemoryLogDevice() {
+			MemoryLogDevice* self = this;
+			priv_signalDevice().compare_exchange_strong(self, nullptr);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that keeps the message in memory
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        ////////////////////////////////////////////////////////////
+		void log(LogLevel level, const std::string& message) override {
+			const std::uint64_t timestamp = detail::recordTimestamp() != 0 ? detail::recordTimestamp() : LogClock::now();
+			Ring& ring = m_rings[priv_threadIndex() % m_rings.size()];
+			const std::uint64_t position = ring.head.fetch_add(1, std::memory_order_relaxed);
+			const std::size_t index = static_cast<std::size_t>(position % m_policy.records);
+			Slot& slot = ring.slots[index];
+			char* data = ring.data.get() + index * m_policy.recordSize;
+
+			if(priv_claim(slot, position)) {
+				priv_write(slot, position, data, level, timestamp, message);
+			}
+
+			if(m_policy.dumpLevel != LogLevel::None && level >= m_policy.dumpLevel) {
+				dump();
+			}
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write the records kept since the last dump to the file
+        ///
+        /// Waits for a dump in progress on another thread. Use
+        /// dumpFromSignalHandler in signal handlers.
+        ////////////////////////////////////////////////////////////
+		void dump() {
+			while(m_dumping.exchange(true, std::memory_order_acquire)) {
+				std::this_thread::yield();
+			}
+			priv_dump();
+			m_dumping.store(false, std::memory_order_release);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write the records kept since the last dump to the file,
+        ///        from a signal handler
+        ///
+        /// Only makes async-signal-safe calls on POSIX systems. Does
+        /// nothing if the signal interrupted a dump.
+        ////////////////////////////////////////////////////////////
+		void dumpFromSignalHandler() {
+			if(m_dumping.exchange(true, std::memory_order_acquire)) {
+				return;
+			}
+			priv_dump();
+			m_dumping.store(false, std::memory_order_release);
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Dump the records when the process receives a fatal signal
+        ///
+        /// Handles SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT: the records
+        /// are dumped, then the signal is raised again with its default
+        /// action. Only one device dumps on the signals, the last one on
+        /// which this function is called.
+        ////////////////////////////////////////////////////////////
+		void dumpOnFatalSignals() {
+			priv_signalDevice().store(this, std::memory_order_release);
+			for(int signal : { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT }) {
+#if defined(RSM_LOG_FILE_POSIX)
+				struct sigaction action;
+				std::memset(&action, 0, sizeof(action));
+				action.sa_handler = &MemoryLogDevice::priv_onFatalSignal;
+				action.sa_flags = SA_RESETHAND;
+				sigemptyset(&action.sa_mask);
+				sigaction(signal, &action, nullptr);
+#else
+				std::signal(signal, &MemoryLogDevice::priv_onFatalSignal);
+#endif
+			}
+		}
+
+	private:
+		struct Slot {
+			std::atomic<std::uint64_t> sequence{0};
+			std::atomic<std::uint64_t> timestamp{0};
+			std::atomic<std::uint32_t> size{0};
+			// Sequence of the record last written by a dump, only used by the dumps
+			std::atomic<std::uint64_t> dumped{0};
+		};
+
+		static constexpr std::size_t CacheLineSize = 64;
+
+		struct Ring {
+			char leadingPadding[CacheLineSize];
+			std::atomic<std::uint64_t> head{0};
+			char headPadding[CacheLineSize];
+			std::uint64_t dumped = 0;
+			std::unique_ptr<Slot[]> slots;
+			std::unique_ptr<char[]> data;
+		};
+
+		struct Cursor {
+			std::uint64_t position;
+			std::uint64_t end;
+			// First record still being written, where the next dump starts
+			std::uint64_t incomplete;
+		};
+
+		// Makes the sequence of the slot odd, so the dumps skip it while it
+		// is written. Fails if a thread lapped by the ring is still writing
+		// an older record in it, or if a newer record took it: two records
+		// written at once in a slot would be mixed.
+		static bool priv_claim(Slot& slot, std::uint64_t position) {
+			std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+			do {
+				if((sequence & 1) != 0 || sequence > 2 * position) {
+					return false;
+				}
+			// Acquires the record of the previous writer, so its bytes are written before ours
+			} while(!slot.sequence.compare_exchange_weak(sequence, 2 * position + 1, std::memory_order_acquire, std::memory_order_relaxed));
+			std::atomic_thread_fence(std::memory_order_release);
+			return true;
+		}
+
+		void priv_write(Slot& slot, std::uint64_t position, char* data, LogLevel level, std::uint64_t timestamp, const std::string& message) {
+			char prefix[LogPrefixFormatter::MaxSize];
+			std::size_t size = formatPrefix(prefix, level);
+			const std::size_t maxSize = m_policy.recordSize - 1;
+			if(size > maxSize) {
+				size = maxSize;
+			}
+			std::memcpy(data, prefix, size);
+			const std::size_t messageSize = message.size() < maxSize - size ? message.size() : maxSize - size;
+			std::memcpy(data + size, message.data(), messageSize);
+			size += messageSize;
+			data[size++] = '\n';
+
+			slot.timestamp.store(timestamp, std::memory_order_relaxed);
+			slot.size.store(static_cast<std::uint32_t>(size), std::memory_order_relaxed);
+			slot.sequence.store(2 * position + 2, std::memory_order_release);
+		}
+
+		// Writes the records of every ring, merged by timestamp. Called
+		// with m_dumping set: allocates nothing, makes no call but write.
+		void priv_dump() {
+			for(std::size_t i = 0; i < m_rings.size(); ++i) {
+				Ring& ring = m_rings[i];
+				const std::uint64_t head = ring.head.load(std::memory_order_acquire);
+				const std::uint64_t oldest = head > m_policy.records ? head - m_policy.records : 0;
+				m_cursors[i].position = ring.dumped > oldest ? ring.dumped : oldest;
+				m_cursors[i].end = head;
+				m_cursors[i].incomplete = head;
+			}
+			for(;;) {
+				std::size_t next = m_rings.size();
+				std::uint64_t nextTimestamp = 0;
+				for(std::size_t i = 0; i < m_rings.size(); ++i) {
+					std::uint64_t timestamp;
+					if(priv_skipToValid(i, timestamp) && (next == m_rings.size() || timestamp < nextTimestamp)) {
+						next = i;
+						nextTimestamp = timestamp;
+					}
+				}
+				if(next == m_rings.size()) {
+					break;
+				}
+				const std::size_t size = priv_copyRecord(next);
+				if(size > 0) {
+					m_file.write(m_record.get(), size);
+				}
+				++m_cursors[next].position;
+			}
+			// The records after the first incomplete one already written are
+			// recognized by their slot, so each record is written once
+			for(std::size_t i = 0; i < m_rings.size(); ++i) {
+				m_rings[i].dumped = m_cursors[i].incomplete;
+			}
+		}
+
+		// Moves the cursor of a ring to its next completely written record
+		// not dumped yet, remembering the first one still being written
+		bool priv_skipToValid(std::size_t ring, std::uint64_t& timestamp) {
+			Cursor& cursor = m_cursors[ring];
+			for(; cursor.position < cursor.end; ++cursor.position) {
+				const Slot& slot = m_rings[ring].slots[cursor.position % m_policy.records];
+				const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+				timestamp = slot.timestamp.load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if(sequence == 2 * cursor.position + 1 && cursor.incomplete == cursor.end) {
+					cursor.incomplete = cursor.position;
+				}
+				if(sequence == 2 * cursor.position + 2 && slot.sequence.load(std::memory_order_relaxed) == sequence &&
+				   slot.dumped.load(std::memory_order_relaxed) != sequence) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// Returns 0 if the record was overwritten while being copied
+		std::size_t priv_copyRecord(std::size_t ring) {
+			const std::uint64_t position = m_cursors[ring].position;
+			const std::size_t index = static_cast<std::size_t>(position % m_policy.records);
+			Slot& slot = m_rings[ring].slots[index];
+			const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			std::size_t size = slot.size.load(std::memory_order_relaxed);
+			if(size > m_policy.recordSize) {
+				size = m_policy.recordSize;
+			}
+			std::memcpy(m_record.get(), m_rings[ring].data.get() + index * m_policy.recordSize, size);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(sequence != 2 * position + 2 || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+				return 0;
+			}
+			slot.dumped.store(sequence, std::memory_order_relaxed);
+			return size;
+		}
+
+		// Keeps errno, which the writes of the dump can change
+		static void priv_onFatalSignal(int signal) {
+			const int savedErrno = errno;
+			MemoryLogDevice* device = priv_signalDevice().load(std::memory_order_acquire);
+			if(device) {
+				device->dumpFromSignalHandler();
+			}
+#if !defined(RSM_LOG_FILE_POSIX)
+			std::signal(signal, SIG_DFL);
+#endif
+			std::raise(signal);
+			errno = savedErrno;
+		}
+
+		static std::atomic<MemoryLogDevice*>& priv_signalDevice() {
+			static std::atomic<MemoryLogDevice*> device{nullptr};
+			return device;
+		}
+
+		// Threads get consecutive indices, spreading them over the rings
+		static std::size_t priv_threadIndex() {
+			static std::atomic<std::size_t> nextIndex{0};
+			thread_local std::size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+			return index;
+		}
+
+	private:
+		MemoryLogPolicy m_policy;
+		std::vector<Ring> m_rings;
+		std::vector<Cursor> m_cursors;
+		std::unique_ptr<char[]> m_record;
+		std::atomic<bool> m_dumping;
+		detail::LogFile m_file;
+	};
+
+}
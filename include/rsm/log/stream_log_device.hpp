@@ -23,6 +23,7 @@
 #pragma once
 
 #include <rsm/log/log_device.hpp>
+#include <mutex>
 #include <iostream>
 
 namespace rsm {
@@ -30,15 +31,26 @@ namespace rsm {
     ////////////////////////////////////////////////////////////
     /// \brief Log device that log to the default stdout stream
     ///
+    /// ConsoleLogDevice writes to the terminal without going through
+    /// std::cout, in batches.
     ////////////////////////////////////////////////////////////
 	class StreamLogDevice final
 		: public LogDevice {
 	public:
-		StreamLogDevice(bool syncWithStdio = false) {
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor
+        ///
+        /// \param syncWithStdio Keep std::cout synchronized with the C
+        ///        streams. When false, std::cout gets its own buffer and
+        ///        is untied from std::cin, which is faster but orders its
+        ///        output freely with printf. Only has an effect before
+        ///        the first input or output of the program.
+        ////////////////////////////////////////////////////////////
+		StreamLogDevice(bool syncWithStdio = true) {
 
-			if(syncWithStdio) {
-				std::cout.sync_with_stdio(false);
-				std::cout.tie(nullptr);
+			if(!syncWithStdio) {
+				std::ios_base::sync_with_stdio(false);
+				std::cin.tie(nullptr);
 			}
 
 		}
@@ -49,8 +61,27 @@ namespace rsm {
         /// \param message Message to log
         ////////////////////////////////////////////////////////////
 		void log(LogLevel level, const std::string& message) override {
-			std::cout << "[" << logLevelToString(level) << "]" << message << "\n";
+			// Formatted first so a record is a single write, whatever the calling thread
+			thread_local std::string line;
+			line.clear();
+			char prefix[LogPrefixFormatter::MaxSize];
+			line.append(prefix, formatPrefix(prefix, level)).append(message).push_back('\n');
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::cout.write(line.data(), static_cast<std::streamsize>(line.size()));
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that flushes the stream
+        ///
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::cout.flush();
 		}
+
+	private:
+		std::mutex m_mutex;
 	};
 
 }
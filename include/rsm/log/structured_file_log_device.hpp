@@ -0,0 +1,217 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/log/log_device.hpp>
+#include <rsm/log/log_clock.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Encoding of the records written by StructuredFileLogDevice
+    ///
+    /// Json writes one object per line:
+    /// {"timestamp_us":1526911392123456,"level":"Info","message":"Request done","latency_us":42}
+    /// Records logged with a source location, like through RSM_LOG_INFO,
+    /// also have "file", "line" and "function" before the message.
+    ///
+    /// Binary starts the file with "RSMSLOG1", then writes every record as:
+    ///     - size of the rest of the record (uint32)
+    ///     - level (uint8)
+    ///     - microseconds since the epoch (int64)
+    ///     - length of the message (uint32) and the message
+    ///     - the fields, encoded as read by LogFields
+    /// Integers use the byte order of the machine writing the file.
+    ////////////////////////////////////////////////////////////
+    enum class StructuredLogFormat {
+        Json,
+        Binary
+    };
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Log device writing the fields of the records typed
+    ///
+    /// The fields attached with LogRecordBuilder::kv are written from
+    /// their typed values, as JSON or binary, without being formatted
+    /// as text first. Records without fields are written with no field.
+    ////////////////////////////////////////////////////////////
+	class StructuredFileLogDevice final
+		: public LogDevice {
+
+	public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor with filename parameter
+        ///
+        /// Creates the log file, truncating it if it already exists.
+        ///
+        /// \param fileName Path to the log file
+        /// \param format Encoding of the records
+        ///
+        /// \throw std::runtime_error if the file can not be created
+        ////////////////////////////////////////////////////////////
+		StructuredFileLogDevice(const std::string& fileName, StructuredLogFormat format = StructuredLogFormat::Json)
+			: m_format(format) {
+			m_file.open(fileName, std::ios::out | std::ios::trunc | std::ios::binary);
+			if(!m_file.is_open()) {
+				throw std::runtime_error("Impossible to create the log file");
+			}
+			if(m_format == StructuredLogFormat::Binary) {
+				m_file.write("RSMSLOG1", 8);
+			}
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes a record without field
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        ////////////////////////////////////////////////////////////
+		void log(LogLevel level, const std::string& message) override {
+			logStructured(level, message, LogFields(nullptr, 0));
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that writes a record and its fields
+        ///
+        /// \param level Log level
+        /// \param message Message to log
+        /// \param fields Typed fields of the record
+        ////////////////////////////////////////////////////////////
+		void logStructured(LogLevel level, const std::string& message, const LogFields& fields) override {
+			std::uint64_t timestamp = detail::recordTimestamp();
+			if(timestamp == 0) {
+				timestamp = LogClock::now();
+			}
+			const auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
+				LogClock::toSystemTime(timestamp).time_since_epoch()).count();
+
+			thread_local std::string record;
+			record.clear();
+			if(m_format == StructuredLogFormat::Json) {
+				priv_encodeJson(record, level, microseconds, message, fields);
+			} else {
+				priv_encodeBinary(record, level, microseconds, message, fields);
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_file.write(record.data(), static_cast<std::streamsize>(record.size()));
+		}
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Overriden function that flushes the file
+        ///
+        ////////////////////////////////////////////////////////////
+		void flush() override {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_file.flush();
+		}
+
+	private:
+		static void priv_encodeJson(std::string& out, LogLevel level, std::int64_t microseconds, const std::string& message, const LogFields& fields) {
+			char number[detail::MaxNumberSize];
+			out.append("{\"timestamp_us\":").append(number, detail::writeInteger(number, microseconds));
+			out.append(",\"level\":\"").append(logLevelName(level)).push_back('"');
+			const LogSourceLocation& location = detail::recordLocation();
+			if(location.file) {
+				out.append(",\"file\":");
+				detail::appendQuotedString(out, location.file, std::char_traits<char>::length(location.file));
+				out.append(",\"line\":").append(number, detail::writeInteger(number, location.line));
+			}
+			if(location.function) {
+				out.append(",\"function\":");
+				detail::appendQuotedString(out, location.function, std::char_traits<char>::length(location.function));
+			}
+			out.append(",\"message\":");
+			detail::appendQuotedString(out, message.data(), message.size());
+			fields.forEach([&out](const LogField& field) {
+				out.push_back(',');
+				detail::appendQuotedString(out, field.key, field.keySize);
+				out.push_back(':');
+				priv_appendJsonValue(out, field.value);
+			});
+			out.append("}\n");
+		}
+
+		static void priv_appendJsonValue(std::string& out, const detail::ArgumentView& value) {
+			char number[detail::MaxNumberSize];
+			switch(value.type) {
+			case detail::ArgumentType::Int:
+				out.append(number, detail::writeInteger(number, value.intValue));
+				break;
+			case detail::ArgumentType::UInt:
+				out.append(number, detail::writeInteger(number, value.uintValue));
+				break;
+			case detail::ArgumentType::Float:
+				if(std::isfinite(value.floatValue)) {
+					out.append(number, detail::writeFloat(number, value.floatValue));
+				} else {
+					out.append("null");
+				}
+				break;
+			case detail::ArgumentType::Double:
+				if(std::isfinite(value.doubleValue)) {
+					out.append(number, detail::writeDouble(number, value.doubleValue));
+				} else {
+					out.append("null");
+				}
+				break;
+			case detail::ArgumentType::Bool:
+				out.append(value.boolValue ? "true" : "false");
+				break;
+			case detail::ArgumentType::Char:
+				detail::appendQuotedString(out, &value.charValue, 1);
+				break;
+			case detail::ArgumentType::String:
+				detail::appendQuotedString(out, value.text, value.textSize);
+				break;
+			}
+		}
+
+		static void priv_encodeBinary(std::string& out, LogLevel level, std::int64_t microseconds, const std::string& message, const LogFields& fields) {
+			const auto size = static_cast<std::uint32_t>(1 + sizeof(microseconds) + sizeof(std::uint32_t) + message.size() + fields.getSize());
+			const auto rawLevel = static_cast<std::uint8_t>(level);
+			const auto messageSize = static_cast<std::uint32_t>(message.size());
+			out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+			out.append(reinterpret_cast<const char*>(&rawLevel), sizeof(rawLevel));
+			out.append(reinterpret_cast<const char*>(&microseconds), sizeof(microseconds));
+			out.append(reinterpret_cast<const char*>(&messageSize), sizeof(messageSize));
+			out.append(message);
+			if(!fields.empty()) {
+				out.append(fields.getData(), fields.getSize());
+			}
+		}
+
+	private:
+		StructuredLogFormat m_format;
+		std::ofstream m_file;
+		std::mutex m_mutex;
+	};
+
+}
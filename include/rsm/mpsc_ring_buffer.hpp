@@ -0,0 +1,188 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Bounded lock-free queue for many producers and one consumer
+    ///
+    /// The slots are allocated and default constructed at construction,
+    /// then reused: producers assign a slot and the consumer reads it in
+    /// place, so elements keeping their memory (like std::string) stop
+    /// allocating once the queue is warm.
+    ///
+    /// Each slot has a sequence number telling whether it is free or
+    /// ready to be consumed. Producers claim a position with a single
+    /// compare-and-swap and never wait for each other.
+    ////////////////////////////////////////////////////////////
+    template<class T>
+    class MpscRingBuffer final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor
+        ///
+        /// \param capacity Minimum number of elements the buffer can hold,
+        ///        rounded up to a power of two
+        ////////////////////////////////////////////////////////////
+        explicit MpscRingBuffer(std::size_t capacity)
+            : m_enqueuePosition(0)
+            , m_dequeuePosition(0) {
+            std::size_t size = 2;
+            while(size < capacity) {
+                size *= 2;
+            }
+            m_mask = size - 1;
+            m_slots.reset(new Slot[size]);
+            for(std::size_t i = 0; i < size; ++i) {
+                m_slots[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MpscRingBuffer(const MpscRingBuffer&) = delete;
+        MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Write an element at the end of the queue
+        ///
+        /// Can be called from any thread. Never blocks.
+        ///
+        /// \param writer Function called with the T& of the claimed slot
+        ///
+        /// \return false if the queue is full, true otherwise
+        ////////////////////////////////////////////////////////////
+        template<class Writer>
+        bool tryPush(Writer&& writer) {
+            std::size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+            Slot* slot;
+            for(;;) {
+                slot = &m_slots[position & m_mask];
+                const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+                if(difference == 0) {
+                    if(m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if(difference < 0) {
+                    return false;
+                } else {
+                    position = m_enqueuePosition.load(std::memory_order_relaxed);
+                }
+            }
+
+            writer(slot->element);
+            slot->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Consume the elements available in the queue
+        ///
+        /// Must only be called from the consumer thread. Stops at the
+        /// first slot still being written by a producer.
+        ///
+        /// \param reader Function called with a T& for every element
+        ///
+        /// \return The number of consumed elements
+        ////////////////////////////////////////////////////////////
+        template<class Reader>
+        std::size_t consume(Reader&& reader) {
+            std::size_t consumed = 0;
+            for(;;) {
+                Slot& slot = m_slots[m_dequeuePosition & m_mask];
+                if(slot.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1) {
+                    return consumed;
+                }
+                reader(slot.element);
+                slot.sequence.store(m_dequeuePosition + m_mask + 1, std::memory_order_release);
+                ++m_dequeuePosition;
+                ++consumed;
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Tell if an element is ready to be consumed
+        ///
+        /// Must only be called from the consumer thread.
+        ///
+        /// \return true if the next slot is not ready yet
+        ////////////////////////////////////////////////////////////
+        bool empty() const {
+            const Slot& slot = m_slots[m_dequeuePosition & m_mask];
+            return slot.sequence.load(std::memory_order_acquire) != m_dequeuePosition + 1;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the number of positions claimed by producers
+        ///
+        /// An element is counted as soon as its producer starts writing it.
+        ///
+        /// \return The total number of elements pushed or being pushed
+        ////////////////////////////////////////////////////////////
+        std::size_t pushedCount() const {
+            return m_enqueuePosition.load(std::memory_order_acquire);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the number of consumed elements
+        ///
+        /// Must only be called from the consumer thread.
+        ///
+        /// \return The total number of consumed elements
+        ////////////////////////////////////////////////////////////
+        std::size_t consumedCount() const {
+            return m_dequeuePosition;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the number of elements the queue can hold
+        ///
+        /// \return The capacity of the queue
+        ////////////////////////////////////////////////////////////
+        std::size_t capacity() const {
+            return m_mask + 1;
+        }
+
+    private:
+        struct Slot {
+            std::atomic<std::size_t> sequence;
+            T element;
+        };
+
+        static constexpr std::size_t CacheLineSize = 64;
+
+        char m_leadingPadding[CacheLineSize];
+        std::atomic<std::size_t> m_enqueuePosition;
+        char m_producerPadding[CacheLineSize];
+        std::size_t m_dequeuePosition;
+        char m_consumerPadding[CacheLineSize];
+        std::size_t m_mask;
+        std::unique_ptr<Slot[]> m_slots;
+    };
+
+}
@@ -24,12 +24,23 @@
 
 #include <rsm/msg/message.hpp>
 #include <rsm/msg/message_handler.hpp>
+#include <rsm/msg/coroutine.hpp>
+#include <rsm/msg/request_table.hpp>
+#include <rsm/msg/executor.hpp>
+#include <rsm/msg/worker_executor.hpp>
+#include <rsm/thread_affinity.hpp>
+#include <rsm/spsc_ring_buffer.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <future>
 #include <thread>
 #include <mutex>
 #include <unordered_map>
 #include <string>
 #include <queue>
 #include <atomic>
+#include <memory>
+#include <stdexcept>
 
 namespace rsm {
 
@@ -52,15 +63,76 @@ namespace rsm {
     /// If this is not done, it is considered undefined behavior.
     ///
     /// Messages are held in a FIFO queue.
+    ///
+    /// When C++20 coroutines are available, a coroutine can also wait
+    /// for a message with co_await rsm::nextMessage(dispatcher, key) and
+    /// push a message with co_await rsm::pushMessageAsync(dispatcher, key,
+    /// message), declared in rsm/msg/coroutine.hpp. Suspended coroutines are
+    /// resumed on the dispatching thread.
+    ///
+    /// Request-reply interactions are supported with request() and reply().
+    ///
+    /// By default, handlers are called on the dispatching thread. An handler
+    /// can instead be bound to a named worker thread owned by the dispatcher
+    /// or to any rsm::Executor, for handlers touching state owned by another
+    /// thread or doing heavy work. Threads can be pinned to CPU cores.
+    ///
+    /// When a single thread pushes the messages, the dispatcher can be built
+    /// in ProducerMode::Single. pushMessage then goes through a wait-free
+    /// ring buffer instead of a mutex-protected queue.
     ////////////////////////////////////////////////////////////
     class AsyncMessageDispatcher final {
     public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Number of threads pushing messages
+        ///
+        ////////////////////////////////////////////////////////////
+        enum class ProducerMode {
+            Multiple,
+            Single
+        };
+
         ////////////////////////////////////////////////////////////
         /// \brief Default constructor
         ///
+        /// Any number of threads can push messages.
+        ////////////////////////////////////////////////////////////
+        AsyncMessageDispatcher()
+            : AsyncMessageDispatcher(ProducerMode::Multiple) {}
+
         ////////////////////////////////////////////////////////////
-        AsyncMessageDispatcher() {
+        /// \brief Constructor with producer mode
+        ///
+        /// In ProducerMode::Single, pushMessage must always be called from
+        /// the same thread, or with an external synchronisation. Messages
+        /// are held in a ring buffer of fixed capacity, pushMessage waiting
+        /// for room when it is full. The other ways of pushing (request and
+        /// pushMessageAsync) still go through the regular queue, with no
+        /// ordering guarantee relative to pushMessage.
+        ///
+        /// \param mode Number of threads pushing messages
+        /// \param capacity Capacity of the ring buffer in ProducerMode::Single,
+        ///        rounded up to a power of two
+        ////////////////////////////////////////////////////////////
+        explicit AsyncMessageDispatcher(ProducerMode mode, std::size_t capacity = 1024)
+            : m_requests(64)
+            , m_dispatchingCpu(-1) {
             m_running = false;
+            m_consumerSleeping = false;
+            if(mode == ProducerMode::Single) {
+                m_ring = std::make_unique<SpscRingBuffer<MessagePair>>(capacity);
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Destructor
+        ///
+        /// Stops the dispatching if it is still running, then stops the
+        /// workers once they ran their remaining handlers.
+        ////////////////////////////////////////////////////////////
+        ~AsyncMessageDispatcher() {
+            stopDispatching();
+            m_workers.clear();
         }
 
         AsyncMessageDispatcher(const AsyncMessageDispatcher&) = delete;
@@ -76,7 +148,47 @@ namespace rsm {
         ////////////////////////////////////////////////////////////
         void registerHandler(const std::string& key, rsm::MessageHandler& handler) {
             std::lock_guard<std::mutex> lock(m_mutex);
-            m_handlers.emplace(std::make_pair(key, &handler));
+            m_handlers.emplace(std::make_pair(key, HandlerEntry{ &handler, nullptr }));
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Register an handler called on a named worker thread
+        ///
+        /// \param key Key corresponding to the handler for message dispatching
+        /// \param handler A rsm::MessageHandler to handle the messages dispatched
+        ///        with the key
+        /// \param workerName Name of a worker previously added with addWorker
+        ///
+        /// \throw std::runtime_error If there is no worker with this name
+        ///
+        /// \see addWorker
+        ////////////////////////////////////////////////////////////
+        void registerHandler(const std::string& key, rsm::MessageHandler& handler, const std::string& workerName) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto worker = m_workers.find(workerName);
+            if(worker == m_workers.end()) {
+                throw std::runtime_error("No worker named " + workerName);
+            }
+            m_handlers.emplace(std::make_pair(key, HandlerEntry{ &handler, worker->second.get() }));
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Register an handler called through an executor
+        ///
+        /// The dispatching thread gives the executor a task calling the
+        /// handler with a copy of the message. The executor must outlive
+        /// its registration, and must not run tasks after the handler
+        /// lifetime is over.
+        ///
+        /// \param key Key corresponding to the handler for message dispatching
+        /// \param handler A rsm::MessageHandler to handle the messages dispatched
+        ///        with the key
+        /// \param executor Executor running the handler
+        ///
+        ////////////////////////////////////////////////////////////
+        void registerHandler(const std::string& key, rsm::MessageHandler& handler, rsm::Executor& executor) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_handlers.emplace(std::make_pair(key, HandlerEntry{ &handler, &executor }));
         }
 
         ////////////////////////////////////////////////////////////
@@ -90,7 +202,7 @@ namespace rsm {
             std::lock_guard<std::mutex> lock(m_mutex);
             auto range = m_handlers.equal_range(key);
             for(auto it = range.first; it != range.second;) {
-                if(it->second == &handler) {
+                if(it->second.handler == &handler) {
                     it = m_handlers.erase(it);
                 } else {
                     ++it;
@@ -108,60 +220,344 @@ namespace rsm {
         ///
         ////////////////////////////////////////////////////////////
         void pushMessage(const std::string& key, const rsm::Message& message = Message()) {
+            if(m_ring) {
+                priv_pushToRing(key, message);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_messages.emplace(std::make_pair(key, message));
+            }
+            m_condition.notify_one();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Push a request and get a future to its reply
+        ///
+        /// The message is pushed like with pushMessage, but carries a
+        /// correlation id. The handler answers it with reply(), so no
+        /// handler has to be registered to receive the reply.
+        /// Timeouts are detected by the dispatching thread.
+        ///
+        /// \param key Key of the request for dispatching
+        /// \param message Content of the request
+        /// \param timeout Delay after which the future holds a std::runtime_error
+        ///
+        /// \return A future to the reply
+        ///
+        /// \throw std::runtime_error If there are too many pending requests
+        ///
+        /// \see reply
+        /// \see setMaxPendingRequests
+        ////////////////////////////////////////////////////////////
+        std::future<rsm::Message> request(const std::string& key, const rsm::Message& message, std::chrono::milliseconds timeout) {
+            return priv_request(key, message, detail::RequestTable::Clock::now() + timeout);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Push a request that never times out
+        ///
+        /// \param key Key of the request for dispatching
+        /// \param message Content of the request
+        ///
+        /// \return A future to the reply
+        ///
+        /// \throw std::runtime_error If there are too many pending requests
+        ////////////////////////////////////////////////////////////
+        std::future<rsm::Message> request(const std::string& key, const rsm::Message& message = Message()) {
+            return priv_request(key, message, detail::RequestTable::Clock::time_point::max());
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Reply to a request
+        ///
+        /// \param request The request message received by the handler
+        /// \param response Message to complete the future of the request with
+        ///
+        /// \return false if the message is not a pending request, for
+        ///         example because it timed out
+        ////////////////////////////////////////////////////////////
+        bool reply(const rsm::Message& request, const rsm::Message& response) {
+            return m_requests.reply(request.getCorrelationId(), response);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the maximum number of requests waiting for a reply
+        ///
+        /// The table of pending requests is allocated up front with this
+        /// size, which is 64 by default.
+        ///
+        /// \param count Maximum number of pending requests
+        ////////////////////////////////////////////////////////////
+        void setMaxPendingRequests(std::size_t count) {
+            m_requests.setCapacity(count);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the capacity of the queue for rsm::pushMessageAsync
+        ///
+        /// pushMessage ignores the capacity and always pushes the message.
+        ///
+        /// \param capacity Maximum number of queued messages before
+        ///        pushMessageAsync suspends, 0 meaning unlimited
+        ///
+        ////////////////////////////////////////////////////////////
+        void setCapacity(std::size_t capacity) {
             std::lock_guard<std::mutex> lock(m_mutex);
-            m_messages.emplace(std::make_pair(key, message));
+            m_capacity = capacity;
         }
 
         ////////////////////////////////////////////////////////////
         /// \brief Start dispatching the messages
         ///
-        /// Starts the second thread onto which the dispatching is occuring
+        /// Starts the second thread onto which the dispatching is occuring.
+        /// Called from an handler after stopDispatching, the dispatching
+        /// thread keeps running.
         ////////////////////////////////////////////////////////////
         void startDispatching() {
+            if(m_thread.joinable()) {
+                if(std::this_thread::get_id() == m_thread.get_id()) {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_running = true;
+                    return;
+                }
+                if(m_running) {
+                    return;
+                }
+                // Stopped from an handler, the thread may still be dispatching its last messages
+                m_thread.join();
+            }
             m_running = true;
             m_thread = std::thread(&AsyncMessageDispatcher::dispatch, this);
-            m_thread.detach();
+            pinThread(m_thread, m_dispatchingCpu);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Add a named worker thread to run handlers on
+        ///
+        /// The worker starts right away and lives as long as the dispatcher.
+        ///
+        /// \param name Name of the worker, used to register handlers
+        /// \param cpu Index of the core to pin the worker to, -1 to let the
+        ///        system schedule it
+        ///
+        /// \throw std::runtime_error If a worker already has this name
+        ////////////////////////////////////////////////////////////
+        void addWorker(const std::string& name, int cpu = -1) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_workers.count(name) != 0) {
+                throw std::runtime_error("A worker is already named " + name);
+            }
+            m_workers.emplace(name, std::make_unique<WorkerExecutor>(cpu));
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Pin the dispatching thread to a CPU core
+        ///
+        /// Applies right away if dispatching, and on every start.
+        ///
+        /// \param cpu Index of the core, -1 to let the system schedule it
+        ///        on every core again
+        ////////////////////////////////////////////////////////////
+        void setDispatchingThreadAffinity(int cpu) {
+            m_dispatchingCpu = cpu;
+            if(cpu < 0) {
+                unpinThread(m_thread);
+            } else {
+                pinThread(m_thread, cpu);
+            }
         }
 
         ////////////////////////////////////////////////////////////
         /// \brief Stop dispatching the messages
         ///
+        /// The messages pushed before the call are dispatched, then the
+        /// dispatching thread is stopped and joined.
+        ///
+        /// Called from an handler on the dispatching thread, the thread
+        /// stops once the pushed messages are dispatched, and is joined by
+        /// the next start or by the destructor.
         ////////////////////////////////////////////////////////////
         void stopDispatching() {
-            m_running = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = false;
+            }
+            m_condition.notify_one();
+            if(m_thread.joinable() && std::this_thread::get_id() != m_thread.get_id()) {
+                m_thread.join();
+            }
         }
 
     private:
-        void dispatch() {
-            while(m_running) {
-                while(m_messages.size() == 0) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                }
+        struct HandlerEntry {
+            rsm::MessageHandler* handler;
+            rsm::Executor* executor;
+        };
 
+        void dispatch() {
+            for(;;) {
                 MessageQueue messageQueue;
                 {
-                    std::lock_guard<std::mutex> lock(m_mutex);
+                    // Spinning a bit before sleeping, the single producer avoids
+                    // the mutex as long as the dispatching thread is awake
+                    for(int spin = 0; m_ring && spin < 64 && m_ring->empty(); ++spin) {
+                        std::this_thread::yield();
+                    }
+
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    const auto hasWork = [this]() {
+                        return !m_running || !m_messages.empty() || (m_ring && !m_ring->empty());
+                    };
+                    if(!hasWork()) {
+                        m_consumerSleeping.store(true);
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                        const auto deadline = m_requests.nextDeadline();
+                        if(deadline == detail::RequestTable::Clock::time_point::max()) {
+                            m_condition.wait(lock, hasWork);
+                        } else {
+                            m_condition.wait_until(lock, deadline, hasWork);
+                        }
+                        m_consumerSleeping.store(false, std::memory_order_relaxed);
+                    }
+                    if(!m_running && m_messages.empty() && !(m_ring && !m_ring->empty())) {
+                        break;
+                    }
                     messageQueue.swap(m_messages);
                 }
+                if(m_ring) {
+                    m_ring->consume([this](MessagePair& messagePair) {
+                        priv_dispatchMessage(messagePair.first, messagePair.second);
+                    });
+                }
                 while(!messageQueue.empty()) {
                     auto messagePair = messageQueue.front();
-                    auto range = m_handlers.equal_range(messagePair.first);
-                    for(auto it = range.first; it != range.second; ++it) {
-                        it->second->onMessage(messagePair.first, messagePair.second);
-                    }
+                    priv_dispatchMessage(messagePair.first, messagePair.second);
                     messageQueue.pop();
                 }
+                m_requests.expire(detail::RequestTable::Clock::now());
+                priv_resumePushers();
+            }
+        }
+
+        void priv_dispatchMessage(const std::string& key, const rsm::Message& message) {
+            auto range = m_handlers.equal_range(key);
+            for(auto it = range.first; it != range.second; ++it) {
+                priv_callHandler(it->second, key, message);
+            }
+            priv_resumeWaiters(key, message);
+        }
+
+        void priv_pushToRing(const std::string& key, const rsm::Message& message) {
+            while(!m_ring->tryPush(key, message)) {
+                std::this_thread::yield();
+            }
+
+            // Pairs with the fence of the dispatching thread going to sleep:
+            // either it sees the new message, or we see it sleeping
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(m_consumerSleeping.load(std::memory_order_relaxed)) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                }
+                m_condition.notify_one();
+            }
+        }
+
+        void priv_callHandler(const HandlerEntry& entry, const std::string& key, const rsm::Message& message) {
+            if(!entry.executor) {
+                entry.handler->onMessage(key, message);
+                return;
+            }
+
+            rsm::MessageHandler* handler = entry.handler;
+            entry.executor->execute([handler, key, message]() {
+                handler->onMessage(key, message);
+            });
+        }
+
+        std::future<rsm::Message> priv_request(const std::string& key, rsm::Message message, detail::RequestTable::Clock::time_point deadline) {
+            auto future = m_requests.open(message, deadline);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_messages.emplace(key, std::move(message));
+            }
+            m_condition.notify_one();
+            return future;
+        }
+
+        template<class> friend class detail::NextMessageAwaiter;
+        template<class> friend class detail::PushMessageAwaiter;
+
+        void priv_waitForMessage(detail::MessageWaiter& waiter) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_waiters.pushBack(waiter);
+            ++m_waiterCount;
+        }
+
+        bool priv_waitForCapacity(detail::PushWaiter& waiter) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(m_capacity == 0 || m_messages.size() < m_capacity) {
+                m_messages.emplace(std::move(waiter.key), std::move(waiter.message));
+                m_condition.notify_one();
+                return false;
+            }
+            m_pushers.pushBack(waiter);
+            return true;
+        }
+
+        void priv_resumeWaiters(const std::string& key, const rsm::Message& message) {
+            if(m_waiterCount == 0) {
+                return;
+            }
+
+            // Resuming outside of the lock, since the coroutine may wait again
+            detail::WaiterList<detail::MessageWaiter> waiters;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_waiterCount -= m_waiters.extract(key, waiters);
+            }
+            while(auto waiter = waiters.popFront()) {
+                waiter->message = &message;
+                waiter->resume();
+            }
+        }
+
+        void priv_resumePushers() {
+            detail::WaiterList<detail::PushWaiter> pushers;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                while(!m_pushers.empty() && (m_capacity == 0 || m_messages.size() < m_capacity)) {
+                    auto pusher = m_pushers.popFront();
+                    m_messages.emplace(std::move(pusher->key), std::move(pusher->message));
+                    pushers.pushBack(*pusher);
+                }
+            }
+            while(auto pusher = pushers.popFront()) {
+                pusher->resume();
             }
         }
 
     private:
-        using HandlerMap = std::unordered_multimap<std::string, rsm::MessageHandler*>;
+        using HandlerMap = std::unordered_multimap<std::string, HandlerEntry>;
         HandlerMap m_handlers;
-        using MessageQueue = std::queue<std::pair<std::string, rsm::Message>>;
+        using MessagePair = std::pair<std::string, rsm::Message>;
+        using MessageQueue = std::queue<MessagePair>;
         MessageQueue m_messages;
         std::thread m_thread;
         std::mutex m_mutex;
+        std::condition_variable m_condition;
         std::atomic<bool> m_running;
+        std::unique_ptr<SpscRingBuffer<MessagePair>> m_ring;
+        std::atomic<bool> m_consumerSleeping;
+        detail::WaiterList<detail::MessageWaiter> m_waiters;
+        detail::WaiterList<detail::PushWaiter> m_pushers;
+        std::atomic<std::size_t> m_waiterCount{0};
+        std::size_t m_capacity = 0;
+        detail::RequestTable m_requests;
+        std::unordered_map<std::string, std::unique_ptr<WorkerExecutor>> m_workers;
+        int m_dispatchingCpu;
     };
 
 }
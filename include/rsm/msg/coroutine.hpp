@@ -0,0 +1,286 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/msg/message.hpp>
+#include <string>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define RSM_HAS_COROUTINE
+#endif
+#endif
+
+#ifdef RSM_HAS_COROUTINE
+#include <coroutine>
+#include <exception>
+#endif
+
+namespace rsm {
+
+    namespace detail {
+
+        // Waiter nodes are stored inside the awaiters, which live in the
+        // coroutine frame, so suspending never allocates. The coroutine is
+        // type-erased and the awaitables are free functions, so the
+        // dispatchers are defined the same way whether or not the including
+        // translation unit is compiled with coroutine support.
+        struct CoroutineWaiter {
+            void resume() {
+                resumeFunction(coroutine);
+            }
+
+            void (*resumeFunction)(void*) = nullptr;
+            void* coroutine = nullptr;
+        };
+
+        struct MessageWaiter
+            : CoroutineWaiter {
+            std::string key;
+            const rsm::Message* message = nullptr;
+            MessageWaiter* next = nullptr;
+        };
+
+        struct PushWaiter
+            : CoroutineWaiter {
+            std::string key;
+            rsm::Message message;
+            PushWaiter* next = nullptr;
+        };
+
+        template<class Waiter>
+        class WaiterList final {
+        public:
+            bool empty() const {
+                return m_head == nullptr;
+            }
+
+            void pushBack(Waiter& waiter) {
+                waiter.next = nullptr;
+                if(m_tail) {
+                    m_tail->next = &waiter;
+                } else {
+                    m_head = &waiter;
+                }
+                m_tail = &waiter;
+            }
+
+            Waiter* popFront() {
+                Waiter* waiter = m_head;
+                if(waiter) {
+                    m_head = waiter->next;
+                    if(!m_head) {
+                        m_tail = nullptr;
+                    }
+                    waiter->next = nullptr;
+                }
+                return waiter;
+            }
+
+            std::size_t extract(const std::string& key, WaiterList& out) {
+                std::size_t count = 0;
+                WaiterList remaining;
+                while(Waiter* waiter = popFront()) {
+                    if(waiter->key == key) {
+                        out.pushBack(*waiter);
+                        ++count;
+                    } else {
+                        remaining.pushBack(*waiter);
+                    }
+                }
+                *this = remaining;
+                return count;
+            }
+
+        private:
+            Waiter* m_head = nullptr;
+            Waiter* m_tail = nullptr;
+        };
+
+        // Friends of the dispatchers, only defined with coroutine support
+        template<class Dispatcher>
+        class NextMessageAwaiter;
+
+        template<class Dispatcher>
+        class PushMessageAwaiter;
+
+    }
+
+}
+
+#ifdef RSM_HAS_COROUTINE
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Fire-and-forget coroutine type for message handling
+    ///
+    /// A coroutine returning rsm::MessageTask starts running as soon as
+    /// it is called and is destroyed once it completes. It is meant to be
+    /// used with the awaitables of the dispatchers, for example:
+    ///
+    /// rsm::MessageTask handshake(rsm::MessageDispatcher& dispatcher) {
+    ///     dispatcher.pushMessage("request");
+    ///     const rsm::Message& ack = co_await rsm::nextMessage(dispatcher, "ack");
+    ///     //...
+    /// }
+    ///
+    /// An exception escaping the coroutine calls std::terminate.
+    ///
+    /// Only available when the compiler supports C++20 coroutines, in
+    /// which case RSM_HAS_COROUTINE is defined.
+    ////////////////////////////////////////////////////////////
+    class MessageTask final {
+    public:
+        struct promise_type {
+            MessageTask get_return_object() const noexcept {
+                return MessageTask();
+            }
+
+            std::suspend_never initial_suspend() const noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() const noexcept {
+                return {};
+            }
+
+            void return_void() const noexcept {}
+
+            void unhandled_exception() const noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+    namespace detail {
+
+        inline void resumeCoroutine(void* coroutine) {
+            std::coroutine_handle<>::from_address(coroutine).resume();
+        }
+
+        inline void setCoroutine(CoroutineWaiter& waiter, std::coroutine_handle<> handle) {
+            waiter.resumeFunction = &resumeCoroutine;
+            waiter.coroutine = handle.address();
+        }
+
+        template<class Dispatcher>
+        class NextMessageAwaiter final {
+        public:
+            NextMessageAwaiter(Dispatcher& dispatcher, const std::string& key)
+                : m_dispatcher(dispatcher) {
+                m_waiter.key = key;
+            }
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                setCoroutine(m_waiter, handle);
+                m_dispatcher.priv_waitForMessage(m_waiter);
+            }
+
+            const rsm::Message& await_resume() const noexcept {
+                return *m_waiter.message;
+            }
+
+        private:
+            Dispatcher& m_dispatcher;
+            MessageWaiter m_waiter;
+        };
+
+        template<class Dispatcher>
+        class PushMessageAwaiter final {
+        public:
+            PushMessageAwaiter(Dispatcher& dispatcher, const std::string& key, const rsm::Message& message)
+                : m_dispatcher(dispatcher) {
+                m_waiter.key = key;
+                m_waiter.message = message;
+            }
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                setCoroutine(m_waiter, handle);
+                return m_dispatcher.priv_waitForCapacity(m_waiter);
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            Dispatcher& m_dispatcher;
+            PushWaiter m_waiter;
+        };
+
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Wait for the next message dispatched with a specific key
+    ///
+    /// To be used with co_await. The coroutine is resumed after the
+    /// handlers of the key were called: from within dispatch() for a
+    /// MessageDispatcher, on the dispatching thread for an
+    /// AsyncMessageDispatcher. The awaited reference to the message is
+    /// valid until the coroutine suspends again.
+    ///
+    /// \param dispatcher MessageDispatcher or AsyncMessageDispatcher
+    /// \param key Key of the message to wait for
+    ///
+    /// \return An awaitable returning a const rsm::Message&
+    ///
+    ////////////////////////////////////////////////////////////
+    template<class Dispatcher>
+    detail::NextMessageAwaiter<Dispatcher> nextMessage(Dispatcher& dispatcher, const std::string& key) {
+        return detail::NextMessageAwaiter<Dispatcher>(dispatcher, key);
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Push a message on the queue of a dispatcher, waiting for
+    ///        room if needed
+    ///
+    /// To be used with co_await. If the queue is below the capacity of
+    /// the dispatcher, the message is pushed and the coroutine continues
+    /// right away on the calling thread. Otherwise the coroutine is
+    /// suspended, and resumed where the dispatcher dispatches once its
+    /// message has been pushed.
+    ///
+    /// \param dispatcher MessageDispatcher or AsyncMessageDispatcher
+    /// \param key Key of the message for dispatching
+    /// \param message Message to push and dispatch
+    ///
+    /// \return An awaitable to co_await on
+    ///
+    /// \see MessageDispatcher::setCapacity
+    ////////////////////////////////////////////////////////////
+    template<class Dispatcher>
+    detail::PushMessageAwaiter<Dispatcher> pushMessageAsync(Dispatcher& dispatcher, const std::string& key,
+                                                            const rsm::Message& message = Message()) {
+        return detail::PushMessageAwaiter<Dispatcher>(dispatcher, key, message);
+    }
+
+}
+
+#endif
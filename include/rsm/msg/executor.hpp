@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <functional>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Executor class to run tasks
+    ///
+    /// This class needs to be inherited and the function execute to be
+    /// overriden. It allows to choose on which thread an handler of the
+    /// rsm::AsyncMessageDispatcher is called, for example to forward the
+    /// messages to a thread owning some state.
+    ///
+    /// \see WorkerExecutor
+    /// \see AsyncMessageDispatcher
+    ////////////////////////////////////////////////////////////
+    class Executor {
+    public:
+        virtual ~Executor() = default;
+
+        Executor(const Executor&) = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Pure virtual function to run a task
+        ///
+        /// The task can be run right away or later, on any thread,
+        /// as long as tasks are run in the order they were given.
+        ///
+        /// \param task Task to run
+        ////////////////////////////////////////////////////////////
+        virtual void execute(std::function<void()> task) = 0;
+
+    protected:
+        Executor() = default;
+    };
+
+}
@@ -23,10 +23,15 @@
 #pragma once
 
 #include <rsm/any.hpp>
+#include <cstdint>
 #include <string>
 
 namespace rsm {
 
+    namespace detail {
+        class RequestTable;
+    }
+
     ////////////////////////////////////////////////////////////
     /// \brief Message class wrapping an object for easy moving
     ///
@@ -74,8 +79,26 @@ namespace rsm {
             return m_content;
         }
 
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the correlation id of the message
+        ///
+        /// Messages pushed with request() carry a correlation id used
+        /// to route the reply back to the requester.
+        ///
+        /// \return The correlation id, 0 if the message is not a request
+        ///
+        /// \see MessageDispatcher::request
+        /// \see AsyncMessageDispatcher::request
+        ////////////////////////////////////////////////////////////
+        std::uint64_t getCorrelationId() const {
+            return m_correlationId;
+        }
+
     private:
+        friend class detail::RequestTable;
+
         rsm::Any m_content;
+        std::uint64_t m_correlationId = 0;
     };
 
 }
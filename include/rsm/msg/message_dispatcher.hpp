@@ -24,6 +24,10 @@
 
 #include <rsm/msg/message.hpp>
 #include <rsm/msg/message_handler.hpp>
+#include <rsm/msg/coroutine.hpp>
+#include <rsm/msg/request_table.hpp>
+#include <chrono>
+#include <future>
 #include <string>
 #include <unordered_map>
 #include <queue>
@@ -48,6 +52,14 @@ namespace rsm {
     /// If this is not done, it is considered undefined behavior.
     ///
     /// Messages are held in a FIFO queue.
+    ///
+    /// When C++20 coroutines are available, a coroutine can also wait
+    /// for a message with co_await rsm::nextMessage(dispatcher, key) and
+    /// push a message with co_await rsm::pushMessageAsync(dispatcher, key,
+    /// message), declared in rsm/msg/coroutine.hpp. Suspended coroutines are
+    /// resumed from within dispatch().
+    ///
+    /// Request-reply interactions are supported with request() and reply().
     ////////////////////////////////////////////////////////////
     class MessageDispatcher final {
     public:
@@ -55,7 +67,8 @@ namespace rsm {
         /// \brief Default constructor
         ///
         ////////////////////////////////////////////////////////////
-        MessageDispatcher() = default;
+        MessageDispatcher()
+            : m_requests(64) {}
 
         MessageDispatcher(const MessageDispatcher&) = delete;
         MessageDispatcher& operator=(const MessageDispatcher&) = delete;
@@ -103,6 +116,83 @@ namespace rsm {
             m_messages.emplace(std::make_pair(key, message));
         }
 
+        ////////////////////////////////////////////////////////////
+        /// \brief Push a request and get a future to its reply
+        ///
+        /// The message is pushed like with pushMessage, but carries a
+        /// correlation id. The handler answers it with reply(), so no
+        /// handler has to be registered to receive the reply.
+        /// Since the dispatching happens on the calling thread, the future
+        /// is only ready once dispatch() was called, and timeouts are only
+        /// detected by dispatch().
+        ///
+        /// \param key Key of the request for dispatching
+        /// \param message Content of the request
+        /// \param timeout Delay after which the future holds a std::runtime_error
+        ///
+        /// \return A future to the reply
+        ///
+        /// \throw std::runtime_error If there are too many pending requests
+        ///
+        /// \see reply
+        /// \see setMaxPendingRequests
+        ////////////////////////////////////////////////////////////
+        std::future<rsm::Message> request(const std::string& key, const rsm::Message& message, std::chrono::milliseconds timeout) {
+            return priv_request(key, message, detail::RequestTable::Clock::now() + timeout);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Push a request that never times out
+        ///
+        /// \param key Key of the request for dispatching
+        /// \param message Content of the request
+        ///
+        /// \return A future to the reply
+        ///
+        /// \throw std::runtime_error If there are too many pending requests
+        ////////////////////////////////////////////////////////////
+        std::future<rsm::Message> request(const std::string& key, const rsm::Message& message = Message()) {
+            return priv_request(key, message, detail::RequestTable::Clock::time_point::max());
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Reply to a request
+        ///
+        /// \param request The request message received by the handler
+        /// \param response Message to complete the future of the request with
+        ///
+        /// \return false if the message is not a pending request, for
+        ///         example because it timed out
+        ////////////////////////////////////////////////////////////
+        bool reply(const rsm::Message& request, const rsm::Message& response) {
+            return m_requests.reply(request.getCorrelationId(), response);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the maximum number of requests waiting for a reply
+        ///
+        /// The table of pending requests is allocated up front with this
+        /// size, which is 64 by default.
+        ///
+        /// \param count Maximum number of pending requests
+        ////////////////////////////////////////////////////////////
+        void setMaxPendingRequests(std::size_t count) {
+            m_requests.setCapacity(count);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Set the capacity of the queue for rsm::pushMessageAsync
+        ///
+        /// pushMessage ignores the capacity and always pushes the message.
+        ///
+        /// \param capacity Maximum number of queued messages before
+        ///        pushMessageAsync suspends, 0 meaning unlimited
+        ///
+        ////////////////////////////////////////////////////////////
+        void setCapacity(std::size_t capacity) {
+            m_capacity = capacity;
+        }
+
         ////////////////////////////////////////////////////////////
         /// \brief Dispatch the queued up messages and remove them from the queue
         ///
@@ -115,6 +205,53 @@ namespace rsm {
                     it->second->onMessage(messagePair.first, messagePair.second);
                 }
                 m_messages.pop();
+                priv_resumeWaiters(messagePair.first, messagePair.second);
+                priv_resumePushers();
+            }
+            m_requests.expire(detail::RequestTable::Clock::now());
+        }
+
+    private:
+        template<class> friend class detail::NextMessageAwaiter;
+        template<class> friend class detail::PushMessageAwaiter;
+
+        std::future<rsm::Message> priv_request(const std::string& key, rsm::Message message, detail::RequestTable::Clock::time_point deadline) {
+            auto future = m_requests.open(message, deadline);
+            m_messages.emplace(key, std::move(message));
+            return future;
+        }
+
+        void priv_waitForMessage(detail::MessageWaiter& waiter) {
+            m_waiters.pushBack(waiter);
+        }
+
+        bool priv_waitForCapacity(detail::PushWaiter& waiter) {
+            if(m_capacity == 0 || m_messages.size() < m_capacity) {
+                m_messages.emplace(std::move(waiter.key), std::move(waiter.message));
+                return false;
+            }
+            m_pushers.pushBack(waiter);
+            return true;
+        }
+
+        void priv_resumeWaiters(const std::string& key, const rsm::Message& message) {
+            if(m_waiters.empty()) {
+                return;
+            }
+
+            detail::WaiterList<detail::MessageWaiter> waiters;
+            m_waiters.extract(key, waiters);
+            while(auto waiter = waiters.popFront()) {
+                waiter->message = &message;
+                waiter->resume();
+            }
+        }
+
+        void priv_resumePushers() {
+            while(!m_pushers.empty() && (m_capacity == 0 || m_messages.size() < m_capacity)) {
+                auto pusher = m_pushers.popFront();
+                m_messages.emplace(std::move(pusher->key), std::move(pusher->message));
+                pusher->resume();
             }
         }
 
@@ -123,6 +260,10 @@ namespace rsm {
         HandlerMap m_handlers;
         using MessageQueue = std::queue<std::pair<std::string, rsm::Message>>;
         MessageQueue m_messages;
+        detail::WaiterList<detail::MessageWaiter> m_waiters;
+        detail::WaiterList<detail::PushWaiter> m_pushers;
+        std::size_t m_capacity = 0;
+        detail::RequestTable m_requests;
     };
 
 }
@@ -0,0 +1,182 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/msg/message.hpp>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace rsm {
+
+    namespace detail {
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Table of the pending requests of a dispatcher
+        ///
+        /// Requests are kept in a flat table of slots reserved up front.
+        /// A correlation id is made of the slot index and of a generation
+        /// counter, so a late reply to a timed out request can never
+        /// complete a newer request reusing the same slot.
+        ////////////////////////////////////////////////////////////
+        class RequestTable final {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            explicit RequestTable(std::size_t capacity)
+                : m_capacity(capacity)
+                , m_pending(0)
+                , m_nextDeadline(Clock::time_point::max()) {
+                m_slots.reserve(capacity);
+                m_freeSlots.reserve(capacity);
+            }
+
+            RequestTable(const RequestTable&) = delete;
+            RequestTable& operator=(const RequestTable&) = delete;
+
+            void setCapacity(std::size_t capacity) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(capacity < m_slots.size()) {
+                    throw std::runtime_error("Cannot shrink the request table below its used slots");
+                }
+                m_capacity = capacity;
+                m_slots.reserve(capacity);
+                m_freeSlots.reserve(capacity);
+            }
+
+            std::future<rsm::Message> open(rsm::Message& request, Clock::time_point deadline) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                std::uint32_t index;
+                if(!m_freeSlots.empty()) {
+                    index = m_freeSlots.back();
+                    m_freeSlots.pop_back();
+                    m_slots[index].promise = std::promise<rsm::Message>();
+                } else if(m_slots.size() < m_capacity) {
+                    index = static_cast<std::uint32_t>(m_slots.size());
+                    m_slots.emplace_back();
+                } else {
+                    throw std::runtime_error("Too many pending requests");
+                }
+
+                Slot& slot = m_slots[index];
+                slot.active = true;
+                slot.deadline = deadline;
+                ++m_pending;
+                if(deadline < m_nextDeadline) {
+                    m_nextDeadline = deadline;
+                }
+
+                request.m_correlationId = (static_cast<std::uint64_t>(slot.generation) << 32) | index;
+                return slot.promise.get_future();
+            }
+
+            bool reply(std::uint64_t correlationId, const rsm::Message& response) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                Slot* slot = priv_find(correlationId);
+                if(!slot) {
+                    return false;
+                }
+                slot->promise.set_value(response);
+                priv_close(*slot, static_cast<std::uint32_t>(correlationId));
+                return true;
+            }
+
+            std::size_t expire(Clock::time_point now) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(now < m_nextDeadline) {
+                    return 0;
+                }
+
+                std::size_t expired = 0;
+                m_nextDeadline = Clock::time_point::max();
+                for(std::uint32_t index = 0; index < m_slots.size(); ++index) {
+                    Slot& slot = m_slots[index];
+                    if(!slot.active) {
+                        continue;
+                    }
+                    if(slot.deadline <= now) {
+                        slot.promise.set_exception(std::make_exception_ptr(std::runtime_error("Request timed out")));
+                        priv_close(slot, index);
+                        ++expired;
+                    } else if(slot.deadline < m_nextDeadline) {
+                        m_nextDeadline = slot.deadline;
+                    }
+                }
+                return expired;
+            }
+
+            Clock::time_point nextDeadline() const {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_nextDeadline;
+            }
+
+            std::size_t pending() const {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_pending;
+            }
+
+        private:
+            struct Slot {
+                std::promise<rsm::Message> promise;
+                Clock::time_point deadline;
+                std::uint32_t generation = 1;
+                bool active = false;
+            };
+
+            Slot* priv_find(std::uint64_t correlationId) {
+                const auto index = static_cast<std::uint32_t>(correlationId);
+                const auto generation = static_cast<std::uint32_t>(correlationId >> 32);
+                if(index >= m_slots.size()) {
+                    return nullptr;
+                }
+                Slot& slot = m_slots[index];
+                if(!slot.active || slot.generation != generation) {
+                    return nullptr;
+                }
+                return &slot;
+            }
+
+            void priv_close(Slot& slot, std::uint32_t index) {
+                slot.active = false;
+                if(++slot.generation == 0) {
+                    slot.generation = 1;
+                }
+                m_freeSlots.push_back(index);
+                --m_pending;
+            }
+
+        private:
+            std::vector<Slot> m_slots;
+            std::vector<std::uint32_t> m_freeSlots;
+            std::size_t m_capacity;
+            std::size_t m_pending;
+            Clock::time_point m_nextDeadline;
+            mutable std::mutex m_mutex;
+        };
+
+    }
+
+}
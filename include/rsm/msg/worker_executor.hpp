@@ -0,0 +1,132 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <rsm/msg/executor.hpp>
+#include <rsm/thread_affinity.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Executor running the tasks on its own thread
+    ///
+    /// The thread is started at construction and optionally pinned to
+    /// a CPU core. Tasks are run in order, by batch, and the remaining
+    /// tasks are run before the thread stops.
+    ///
+    /// \see Executor
+    ////////////////////////////////////////////////////////////
+    class WorkerExecutor final
+        : public Executor {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor
+        ///
+        /// \param cpu Index of the core to pin the thread to, -1 to let
+        ///        the system schedule it
+        ////////////////////////////////////////////////////////////
+        explicit WorkerExecutor(int cpu = -1)
+            : m_running(true) {
+            m_thread = std::thread(&WorkerExecutor::run, this);
+            pinThread(m_thread, cpu);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Destructor
+        ///
+        /// Runs the remaining tasks and stops the thread.
+        ////////////////////////////////////////////////////////////
+        ~WorkerExecutor() {
+            stop();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Queue a task to be run on the worker thread
+        ///
+        /// \param task Task to run
+        ////////////////////////////////////////////////////////////
+        void execute(std::function<void()> task) override {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.emplace_back(std::move(task));
+            }
+            m_condition.notify_one();
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Run the remaining tasks and stop the thread
+        ///
+        /// Tasks given after the worker is stopped are never run.
+        ////////////////////////////////////////////////////////////
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_running = false;
+            }
+            m_condition.notify_one();
+            if(m_thread.joinable()) {
+                m_thread.join();
+            }
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the id of the worker thread
+        ///
+        /// \return The id of the thread running the tasks
+        ////////////////////////////////////////////////////////////
+        std::thread::id getThreadId() const {
+            return m_thread.get_id();
+        }
+
+    private:
+        void run() {
+            std::vector<std::function<void()>> tasks;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(m_running || !m_tasks.empty()) {
+                m_condition.wait(lock, [this]() {
+                    return !m_running || !m_tasks.empty();
+                });
+                tasks.swap(m_tasks);
+                lock.unlock();
+                for(auto& task : tasks) {
+                    task();
+                }
+                tasks.clear();
+                lock.lock();
+            }
+        }
+
+    private:
+        std::vector<std::function<void()>> m_tasks;
+        std::thread m_thread;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_running;
+    };
+
+}
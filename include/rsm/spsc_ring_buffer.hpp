@@ -0,0 +1,181 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rsm {
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Bounded wait-free queue for one producer and one consumer
+    ///
+    /// The elements are stored in a ring buffer allocated at construction.
+    /// Exactly one thread may push and exactly one other thread may
+    /// consume at any time.
+    ///
+    /// The indexes of the producer and of the consumer are kept on separate
+    /// cache lines, each with a cached copy of the other side's index, so
+    /// the shared lines are only read when the cached view says the queue
+    /// is full or empty. The consumer publishes its index once per batch.
+    ////////////////////////////////////////////////////////////
+    template<class T>
+    class SpscRingBuffer final {
+    public:
+        ////////////////////////////////////////////////////////////
+        /// \brief Constructor
+        ///
+        /// \param capacity Minimum number of elements the buffer can hold,
+        ///        rounded up to a power of two
+        ////////////////////////////////////////////////////////////
+        explicit SpscRingBuffer(std::size_t capacity)
+            : m_head(0)
+            , m_cachedTail(0)
+            , m_tail(0)
+            , m_cachedHead(0) {
+            std::size_t size = 2;
+            while(size < capacity) {
+                size *= 2;
+            }
+            m_mask = size - 1;
+            m_slots.reset(new Slot[size]);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Destructor
+        ///
+        /// Destroys the elements that were not consumed.
+        ////////////////////////////////////////////////////////////
+        ~SpscRingBuffer() {
+            const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            for(std::size_t head = m_head.load(std::memory_order_relaxed); head != tail; ++head) {
+                priv_element(head).~T();
+            }
+        }
+
+        SpscRingBuffer(const SpscRingBuffer&) = delete;
+        SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Construct an element at the end of the queue
+        ///
+        /// Must only be called from the producer thread. Never blocks.
+        ///
+        /// \param args Arguments to construct the element with
+        ///
+        /// \return false if the queue is full, true otherwise
+        ////////////////////////////////////////////////////////////
+        template<class... Args>
+        bool tryPush(Args&&... args) {
+            const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+            if(tail - m_cachedHead > m_mask) {
+                m_cachedHead = m_head.load(std::memory_order_acquire);
+                if(tail - m_cachedHead > m_mask) {
+                    return false;
+                }
+            }
+            new (&m_slots[tail & m_mask]) T(std::forward<Args>(args)...);
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Consume the elements available in the queue
+        ///
+        /// Must only be called from the consumer thread. Every element is
+        /// given to the function, then destroyed. The freed slots are
+        /// published to the producer once the whole batch is consumed.
+        ///
+        /// \param function Function called with a T& for every element
+        ///
+        /// \return The number of consumed elements
+        ////////////////////////////////////////////////////////////
+        template<class Function>
+        std::size_t consume(Function&& function) {
+            const std::size_t head = m_head.load(std::memory_order_relaxed);
+            if(head == m_cachedTail) {
+                m_cachedTail = m_tail.load(std::memory_order_acquire);
+                if(head == m_cachedTail) {
+                    return 0;
+                }
+            }
+
+            const std::size_t tail = m_cachedTail;
+            for(std::size_t index = head; index != tail; ++index) {
+                T& element = priv_element(index);
+                function(element);
+                element.~T();
+            }
+            m_head.store(tail, std::memory_order_release);
+            return tail - head;
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Tell if the queue is empty
+        ///
+        /// The result is only a snapshot when called from a thread other
+        /// than the producer and the consumer.
+        ///
+        /// \return true if there is no element to consume
+        ////////////////////////////////////////////////////////////
+        bool empty() const {
+            return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+        }
+
+        ////////////////////////////////////////////////////////////
+        /// \brief Return the number of elements the queue can hold
+        ///
+        /// \return The capacity of the queue
+        ////////////////////////////////////////////////////////////
+        std::size_t capacity() const {
+            return m_mask + 1;
+        }
+
+    private:
+        using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+        T& priv_element(std::size_t index) {
+            return *reinterpret_cast<T*>(&m_slots[index & m_mask]);
+        }
+
+        static constexpr std::size_t CacheLineSize = 64;
+
+        char m_leadingPadding[CacheLineSize];
+        // Consumer side
+        std::atomic<std::size_t> m_head;
+        std::size_t m_cachedTail;
+        char m_consumerPadding[CacheLineSize];
+        // Producer side
+        std::atomic<std::size_t> m_tail;
+        std::size_t m_cachedHead;
+        char m_producerPadding[CacheLineSize];
+        // Read-only after construction
+        std::size_t m_mask;
+        std::unique_ptr<Slot[]> m_slots;
+    };
+
+}
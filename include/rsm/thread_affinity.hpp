@@ -0,0 +1,126 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#pragma once
+
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace rsm {
+
+#if defined(__linux__)
+    namespace detail {
+
+        // Cores of the process, taken before pinThread pins any thread, as
+        // Linux has no process-wide mask to read back once threads are pinned
+        inline const cpu_set_t& processAffinity() {
+            static const cpu_set_t cpus = []() {
+                cpu_set_t allowed;
+                CPU_ZERO(&allowed);
+                if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+                    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                        CPU_SET(cpu, &allowed);
+                    }
+                }
+                return allowed;
+            }();
+            return cpus;
+        }
+
+    }
+#endif
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Pin a thread to a specific CPU core
+    ///
+    /// Keeping a thread on one core avoids migrating its working set
+    /// between caches. Supported on Linux and Windows, does nothing on
+    /// other platforms.
+    ///
+    /// \param thread Thread to pin
+    /// \param cpu Index of the core, negative values are ignored
+    ///
+    /// \return true if the thread was pinned, false otherwise
+    ////////////////////////////////////////////////////////////
+    inline bool pinThread(std::thread& thread, int cpu) {
+        if(cpu < 0 || !thread.joinable()) {
+            return false;
+        }
+#if defined(_WIN32)
+        if(cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+            return false;
+        }
+        return SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#elif defined(__linux__)
+        if(cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        detail::processAffinity();
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+#else
+        return false;
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////
+    /// \brief Let a pinned thread run on every core of the process again
+    ///
+    /// Supported on Linux and Windows, does nothing on other platforms.
+    /// On Linux, the cores of the process are the ones of the thread
+    /// which first called pinThread or unpinThread.
+    ///
+    /// \param thread Thread to unpin
+    ///
+    /// \return true if the thread was unpinned, false otherwise
+    ////////////////////////////////////////////////////////////
+    inline bool unpinThread(std::thread& thread) {
+        if(!thread.joinable()) {
+            return false;
+        }
+#if defined(_WIN32)
+        DWORD_PTR processMask;
+        DWORD_PTR systemMask;
+        if(!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+            return false;
+        }
+        return SetThreadAffinityMask(thread.native_handle(), processMask) != 0;
+#elif defined(__linux__)
+        const cpu_set_t& cpus = detail::processAffinity();
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) == 0;
+#else
+        return false;
+#endif
+    }
+
+}
@@ -25,9 +25,41 @@
 #include <rsm/log/logger.hpp>
 #include <rsm/log/stream_log_device.hpp>
 #include <rsm/log/file_log_device.hpp>
+#include <rsm/log/binary_file_log_device.hpp>
+#include <rsm/log/binary_log_reader.hpp>
+#include <rsm/log/buffered_file_log_device.hpp>
+#include <rsm/log/mapped_file_log_device.hpp>
+#include <rsm/log/mapped_log_reader.hpp>
+#include <rsm/log/structured_file_log_device.hpp>
+#include <rsm/log/memory_log_device.hpp>
+#include <rsm/log/log_category.hpp>
+#include <rsm/log/console_log_device.hpp>
+#include <rsm/log/compressed_file_log_device.hpp>
+#include <rsm/log/compressed_log_reader.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 class LoggingTestClass {
 public:
@@ -45,6 +77,46 @@ std::ostream& operator<<(std::ostream& out, const LoggingTestClass& logging) {
     return out << logging.m_data;
 }
 
+// Logs a record of its own while being streamed in another one
+class NestedLoggingTestClass {};
+
+std::ostream& operator<<(std::ostream& out, const NestedLoggingTestClass&) {
+    rsm::Logger::debug() << "Inner";
+    return out << "Outer";
+}
+
+// Flushes, stops and logs back into the Logger from the background thread
+class ReentrantLogDevice : public rsm::LogDevice {
+public:
+    void log(rsm::LogLevel, const std::string& message) override {
+        messages.push_back(message);
+        if(message != "Reentrant") {
+            return;
+        }
+        rsm::Logger::flush();
+        try {
+            rsm::Logger::stopAsync();
+        } catch(const std::logic_error&) {
+            stopRefused = true;
+        }
+        for(int i = 0; i < 100; ++i) {
+            rsm::Logger::info() << "Echo";
+        }
+    }
+
+    std::vector<std::string> messages;
+    bool stopRefused = false;
+};
+
+// Constructed before the Logger, so destroyed after it at exit
+rsm::LogCategory staticCategory("static");
+
+// Line of the statement, to compare with the location of its record
+int logLocatedRecord() {
+    RSM_LOG_WARNING << "Located"; const int line = __LINE__;
+    return line;
+}
+
 TEST_CASE("Testing logging", "[log]") {
 
 	SECTION("File Log Device") {
@@ -180,7 +252,7 @@ TEST_CASE("Log Streaming", "[log]") {
         REQUIRE(content.find("Test Single") != std::string::npos);
     }
     
-    SECTION("Single item stream") {
+    SECTION("Multiple items stream") {
         const std::string logFileName = "log-stream-multi";
         
         rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
@@ -195,15 +267,28 @@ TEST_CASE("Log Streaming", "[log]") {
         std::string content;
         std::getline(stream, content);
         INFO(content)
-        REQUIRE(content.find("Test Multi 1") != std::string::npos);
+        REQUIRE(content.find("Test Multi 1Test Multi 23") != std::string::npos);
         
-        std::getline(stream, content);
-        INFO(content)
-        REQUIRE(content.find("Test Multi 2") != std::string::npos);
+        REQUIRE_FALSE(std::getline(stream, content));
+    }
+
+    SECTION("Logging while streaming") {
+        const std::string logFileName = "log-stream-nested";
+        
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
         
+        rsm::Logger::info() << NestedLoggingTestClass();
+        rsm::Logger::resetLogDevices();
+        
+        std::ifstream stream;
+        stream.open(logFileName, std::ios::in);
+        
+        REQUIRE(stream.is_open());
+        std::string content;
         std::getline(stream, content);
-        INFO(content)
-        REQUIRE(content.find("3") != std::string::npos);
+        REQUIRE(content == "[Debug]Inner");
+        std::getline(stream, content);
+        REQUIRE(content == "[Info]Outer");
     }
     
     SECTION("Custom class streaming") {
@@ -226,3 +311,1545 @@ TEST_CASE("Log Streaming", "[log]") {
         REQUIRE(content.find(testClassData) != std::string::npos);
     }
 }
+
+namespace {
+
+    int evaluations = 0;
+
+    int evaluated(int value) {
+        ++evaluations;
+        return value;
+    }
+
+    std::vector<std::string> readLines(const std::string& fileName) {
+        std::ifstream stream(fileName, std::ios::in);
+        std::vector<std::string> lines;
+        std::string content;
+        while(std::getline(stream, content)) {
+            lines.push_back(content);
+        }
+        return lines;
+    }
+
+}
+
+TEST_CASE("Log Filtering", "[log]") {
+
+    SECTION("Logger threshold") {
+        const std::string logFileName = "log-threshold";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::Warning);
+
+        REQUIRE_FALSE(rsm::Logger::isEnabled(rsm::LogLevel::Info));
+        REQUIRE(rsm::Logger::isEnabled(rsm::LogLevel::Error));
+
+        rsm::Logger::debug() << "Debug";
+        rsm::Logger::info() << "Info";
+        rsm::Logger::warning() << "Warning";
+        rsm::Logger::error() << "Error";
+
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::None);
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Warning]Warning", "[Error]Error" }));
+    }
+
+    SECTION("Device threshold") {
+        const std::string allFileName = "log-device-all";
+        const std::string errorFileName = "log-device-error";
+
+        auto errorDevice = std::make_unique<rsm::FileLogDevice>(errorFileName);
+        errorDevice->setLogLevel(rsm::LogLevel::Error);
+        REQUIRE(errorDevice->getLogLevel() == rsm::LogLevel::Error);
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(allFileName));
+        rsm::Logger::addLogDevice(std::move(errorDevice));
+
+        rsm::Logger::info() << "Info";
+        rsm::Logger::error() << "Error";
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(allFileName).size() == 2);
+        REQUIRE(readLines(errorFileName) == std::vector<std::string>({ "[Error]Error" }));
+    }
+
+    SECTION("Arguments of disabled macros not evaluated") {
+        const std::string logFileName = "log-macro";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::Info);
+        evaluations = 0;
+
+        RSM_LOG_DEBUG << evaluated(1);
+        RSM_LOG_INFO << evaluated(2);
+        if(evaluations == 1)
+            RSM_LOG_WARNING << evaluated(3);
+        else
+            RSM_LOG_ERROR << "Dangling else";
+
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::None);
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(evaluations == 2);
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]2", "[Warning]3" }));
+    }
+
+    SECTION("Macros removed at compile time") {
+        const std::string logFileName = "log-macro-compile-time";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        evaluations = 0;
+
+#undef RSM_LOG_MIN_LEVEL
+#define RSM_LOG_MIN_LEVEL 4
+        RSM_LOG_WARNING << evaluated(1);
+        RSM_LOG_CRITICAL << evaluated(2);
+#undef RSM_LOG_MIN_LEVEL
+#define RSM_LOG_MIN_LEVEL 0
+
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(evaluations == 1);
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Critical]2" }));
+    }
+
+}
+
+TEST_CASE("Log Formatting", "[log]") {
+
+    SECTION("Built-in types formatted without the stream") {
+        const std::string logFileName = "log-format-builtin";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        const char* missing = nullptr;
+        int value = 0;
+        std::ostringstream address;
+        address << "0x" << std::hex << reinterpret_cast<std::uintptr_t>(&value);
+
+        rsm::Logger::info() << -42 << ' ' << 42u << ' ' << std::numeric_limits<long long>::min() << ' '
+                            << std::numeric_limits<unsigned long long>::max() << ' ' << static_cast<short>(-7);
+        rsm::Logger::info() << 0.1 << ' ' << 3.14159265 << ' ' << 1.5f << ' ' << 100.0 << ' ' << 0.00012 << ' '
+                            << 1e20 << ' ' << -0.0 << ' ' << 0.1 + 0.2 << ' ' << std::numeric_limits<double>::infinity();
+        rsm::Logger::info() << 0.1f << ' ' << 1e-7f << ' ' << 3.14159265f << ' ' << 16777216.0f;
+        rsm::Logger::info() << true << ' ' << 'c' << ' ' << std::string("string") << ' ' << missing << ' ' << &value;
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({
+            "[Info]-42 42 -9223372036854775808 18446744073709551615 -7",
+            "[Info]0.1 3.14159265 1.5 100 0.00012 1e+20 -0 0.30000000000000004 inf",
+            "[Info]0.1 1e-07 3.1415927 16777216",
+            "[Info]1 c string (null) " + address.str()
+        }));
+    }
+
+    SECTION("Manipulators applied by the stream for the record") {
+        const std::string logFileName = "log-format-manipulators";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        rsm::Logger::info() << std::hex << 255 << std::dec << ' ' << std::setprecision(3) << 3.14159 << ' ' << std::setw(4) << 7
+                            << ' ' << std::boolalpha << true;
+        rsm::Logger::info() << 255 << ' ' << 3.14159 << ' ' << true;
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]ff 3.14    7 true", "[Info]255 3.14159 1" }));
+    }
+
+    SECTION("Doubles read back as the same value") {
+        std::vector<double> values = { 1.0, 0.1, 1.0 / 3.0, 2.0 / 3.0, 1e-5, 9.999999999999999e-6, 123456.789, 999999999999999.9,
+                                       1e15, 1e16, 4.35, 5e-324, 2.2250738585072014e-308, std::numeric_limits<double>::max() };
+        for(int i = 1; i < 1000; ++i) {
+            values.push_back(i * 0.001);
+            values.push_back(i * 1e-5 + 7.25);
+        }
+        std::mt19937_64 random(42);
+        std::uniform_real_distribution<double> fraction(0.0, 1.0);
+        std::uniform_int_distribution<int> exponent(-20, 20);
+        for(int i = 0; i < 10000; ++i) {
+            values.push_back(fraction(random) * std::pow(10.0, exponent(random)));
+            std::uint64_t bits = random();
+            double any;
+            std::memcpy(&any, &bits, sizeof(any));
+            if(std::isfinite(any)) {
+                values.push_back(any);
+            }
+        }
+
+        // Digits of the mantissa without the zeros around them
+        const auto significantDigits = [](const std::string& text) {
+            std::string digits;
+            for(const char c : text.substr(0, text.find('e'))) {
+                if(c >= '0' && c <= '9') {
+                    digits.push_back(c);
+                }
+            }
+            const auto first = digits.find_first_not_of('0');
+            return first == std::string::npos ? std::size_t(0) : digits.find_last_not_of('0') - first + 1;
+        };
+
+        char text[rsm::detail::MaxNumberSize];
+        char shortest[rsm::detail::MaxNumberSize];
+        std::size_t longer = 0;
+        for(const double value : values) {
+            const std::string written(text, rsm::detail::writeDouble(text, value));
+            INFO(written);
+            REQUIRE(std::strtod(written.c_str(), nullptr) == value);
+
+            // No fewer digits read back as the value, except for a few values left to Grisu2
+            int precision = 1;
+            while(std::snprintf(shortest, sizeof(shortest), "%.*g", precision, value) > 0 && std::strtod(shortest, nullptr) != value) {
+                ++precision;
+            }
+            const std::size_t digits = significantDigits(written);
+            REQUIRE(digits <= 17);
+            if(std::fabs(value) >= 1e-5 && std::fabs(value) < 1e15 && precision <= 15) {
+                REQUIRE(digits == static_cast<std::size_t>(precision));
+            } else if(digits > static_cast<std::size_t>(precision)) {
+                ++longer;
+            }
+        }
+        REQUIRE(longer < values.size() / 100);
+    }
+
+    SECTION("Floats read back as the same float") {
+        std::vector<float> values = { 1.0f, 0.1f, 1e-7f, 1.0f / 3.0f, 1e-4f, 9.99999e-5f, 1234.567f, 9999999.0f, 1e7f, 16777217.0f,
+                                      1e-45f, 1.17549435e-38f, std::numeric_limits<float>::max() };
+        std::mt19937 random(42);
+        for(int i = 0; i < 10000; ++i) {
+            std::uint32_t bits = random();
+            float any;
+            std::memcpy(&any, &bits, sizeof(any));
+            if(std::isfinite(any)) {
+                values.push_back(any);
+            }
+        }
+
+        char text[rsm::detail::MaxNumberSize];
+        char shortest[rsm::detail::MaxNumberSize];
+        std::size_t longer = 0;
+        for(const float value : values) {
+            const std::string written(text, rsm::detail::writeFloat(text, value));
+            INFO(written);
+            REQUIRE(std::strtof(written.c_str(), nullptr) == value);
+
+            // Never longer than the 9 digits of any float, rarely longer than the shortest
+            int precision = 1;
+            while(std::snprintf(shortest, sizeof(shortest), "%.*g", precision, value) > 0 && std::strtof(shortest, nullptr) != value) {
+                ++precision;
+            }
+            std::string digits = written.substr(0, written.find('e'));
+            digits.erase(std::remove_if(digits.begin(), digits.end(), [](char c) { return c < '0' || c > '9'; }), digits.end());
+            digits.erase(0, digits.find_first_not_of('0'));
+            digits.erase(digits.find_last_not_of('0') + 1);
+            REQUIRE(digits.size() <= 9);
+            if(digits.size() > static_cast<std::size_t>(precision)) {
+                ++longer;
+            }
+        }
+        REQUIRE(longer < values.size() / 100);
+    }
+
+}
+
+TEST_CASE("Log Rate Limiting", "[log]") {
+
+    SECTION("Sampling") {
+        const std::string logFileName = "log-sampling";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        evaluations = 0;
+
+        for(int i = 0; i < 25; ++i) {
+            RSM_LOG_EVERY_N(rsm::LogLevel::Info, 10) << evaluated(i);
+        }
+        rsm::Logger::flush();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(evaluations == 3);
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]0", "[Info]10", "[Info]20" }));
+    }
+
+    SECTION("Rate limited statement") {
+        const std::string logFileName = "log-rate-limited";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        evaluations = 0;
+
+        for(int i = 0; i < 100; ++i) {
+            RSM_LOG_RATE_LIMITED(rsm::LogLevel::Warning, 1, 5) << evaluated(i);
+        }
+        rsm::Logger::flush();
+        rsm::Logger::flush();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(evaluations == 5);
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == 6);
+        REQUIRE(lines[4] == "[Warning]4");
+        REQUIRE(lines[5].find("[Warning]Suppressed 95 records at ") == 0);
+        REQUIRE(lines[5].find(__FILE__) != std::string::npos);
+    }
+
+    SECTION("Suppressed count reported with the next record") {
+        const std::string logFileName = "log-rate-limited-next";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        for(int i = 0; i < 3; ++i) {
+            RSM_LOG_RATE_LIMITED(rsm::LogLevel::Info, 50, 1) << "Record " << i;
+            if(i == 1) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(40));
+            }
+        }
+        rsm::Logger::resetLogDevices();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == 3);
+        REQUIRE(lines[0] == "[Info]Record 0");
+        REQUIRE(lines[1].find("[Info]Suppressed 1 records at ") == 0);
+        REQUIRE(lines[2] == "[Info]Record 2");
+    }
+
+    SECTION("Suppressed count of a stopped statement reported periodically") {
+        const std::string logFileName = "log-rate-limited-periodic";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        for(int i = 0; i < 3; ++i) {
+            RSM_LOG_RATE_LIMITED(rsm::LogLevel::Info, 1, 1) << "Stopped " << i;
+        }
+        const auto reportTime = std::chrono::steady_clock::now() + std::chrono::nanoseconds(rsm::detail::LogSite::ReportInterval);
+        bool reportDue = false;
+        do {
+            reportDue = std::chrono::steady_clock::now() > reportTime;
+            RSM_LOG_RATE_LIMITED(rsm::LogLevel::Debug, 0.001, 1) << "Running";
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } while(!reportDue);
+        rsm::Logger::resetLogDevices();
+        // Drops the records suppressed after the report
+        rsm::Logger::reportSuppressedRecords();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() >= 4);
+        REQUIRE(lines[0] == "[Info]Stopped 0");
+        REQUIRE(lines[1] == "[Debug]Running");
+        const auto reported = [&lines](const std::string& start) {
+            return std::any_of(lines.begin() + 2, lines.end(), [&start](const std::string& line) { return line.find(start) == 0; });
+        };
+        REQUIRE(reported("[Info]Suppressed 2 records at "));
+        REQUIRE(reported("[Debug]Suppressed "));
+    }
+
+    SECTION("Tiny rates clamped") {
+        const std::string logFileName = "log-rate-limited-tiny";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        for(int i = 0; i < 3; ++i) {
+            RSM_LOG_RATE_LIMITED(rsm::LogLevel::Info, 1e-300, 1000) << "Record " << i;
+        }
+        rsm::Logger::flush();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Record 0", "[Info]Record 1", "[Info]Record 2" }));
+    }
+
+    SECTION("Default rate limit") {
+        const std::string logFileName = "log-default-rate-limit";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        rsm::Logger::setRateLimit(1, 3);
+
+        for(int i = 0; i < 10; ++i) {
+            RSM_LOG_INFO << "Record " << i;
+            rsm::Logger::info() << "Not limited";
+        }
+
+        rsm::Logger::setRateLimit(0);
+        RSM_LOG_INFO << "Unlimited";
+        RSM_LOG_INFO << "Unlimited";
+        rsm::Logger::flush();
+        rsm::Logger::resetLogDevices();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(std::count(lines.begin(), lines.end(), "[Info]Not limited") == 10);
+        REQUIRE(std::count(lines.begin(), lines.end(), "[Info]Record 2") == 1);
+        REQUIRE(std::count(lines.begin(), lines.end(), "[Info]Record 3") == 0);
+        REQUIRE(std::count(lines.begin(), lines.end(), "[Info]Unlimited") == 2);
+        REQUIRE(lines.back().find("[Info]Suppressed 7 records at ") == 0);
+    }
+
+}
+
+TEST_CASE("Concurrent Logging", "[log]") {
+
+    SECTION("Records and levels of the threads kept apart") {
+        const std::string logFileName = "log-concurrent";
+        const int threadCount = 8;
+        const int count = 2000;
+        const rsm::LogLevel levels[] = { rsm::LogLevel::Debug, rsm::LogLevel::Info, rsm::LogLevel::Warning, rsm::LogLevel::Critical, rsm::LogLevel::Error };
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        std::vector<std::thread> threads;
+        for(int thread = 0; thread < threadCount; ++thread) {
+            threads.emplace_back([&, thread]() {
+                rsm::Logger::setCurrentLogLevel(levels[thread % 5]);
+                for(int i = 0; i < count; ++i) {
+                    rsm::Logger::log(thread * count + i);
+                }
+            });
+        }
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        rsm::Logger::resetLogDevices();
+
+        std::ifstream stream;
+        stream.open(logFileName, std::ios::in);
+
+        REQUIRE(stream.is_open());
+        std::vector<int> next(threadCount, 0);
+        int lines = 0;
+        bool intact = true;
+        std::string content;
+        while(std::getline(stream, content)) {
+            const auto end = content.find(']');
+            const int value = std::stoi(content.substr(end + 1));
+            const int thread = value / count;
+            intact = intact && content.substr(1, end - 1) == rsm::logLevelToString(levels[thread % 5]);
+            intact = intact && value % count == next[thread]++;
+            ++lines;
+        }
+        REQUIRE(intact);
+        REQUIRE(lines == threadCount * count);
+    }
+
+    SECTION("Devices changed while logging") {
+        const std::string logFileName = "log-concurrent-devices";
+        const int threadCount = 4;
+
+        auto device = std::make_shared<rsm::FileLogDevice>(logFileName);
+        auto otherDevice = std::make_shared<rsm::FileLogDevice>(logFileName + "-other");
+        std::atomic<bool> running(true);
+        std::atomic<int> logged(0);
+        std::vector<std::thread> threads;
+        for(int thread = 0; thread < threadCount; ++thread) {
+            threads.emplace_back([&]() {
+                while(running) {
+                    rsm::Logger::info() << "Record";
+                    ++logged;
+                }
+            });
+        }
+        for(int i = 0; i < 200; ++i) {
+            rsm::Logger::addLogDevice(device);
+            rsm::Logger::addLogDevice(otherDevice);
+            rsm::Logger::resetLogDevices();
+        }
+        rsm::Logger::addLogDevice(device);
+        const int before = logged;
+        while(logged < before + 100) {
+            std::this_thread::yield();
+        }
+        running = false;
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        rsm::Logger::resetLogDevices();
+        device.reset();
+        otherDevice.reset();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() >= 100);
+        REQUIRE(std::all_of(lines.begin(), lines.end(), [](const std::string& line) { return line == "[Info]Record"; }));
+    }
+
+}
+
+TEST_CASE("Async Logging", "[log]") {
+
+    SECTION("Records written by the background thread") {
+        const std::string logFileName = "log-async";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        rsm::Logger::startAsync(16);
+
+        for(int i = 0; i < 100; ++i) {
+            rsm::Logger::info() << i;
+        }
+        rsm::Logger::flush();
+
+        std::ifstream stream;
+        stream.open(logFileName, std::ios::in);
+
+        REQUIRE(stream.is_open());
+        int lines = 0;
+        std::string content;
+        while(std::getline(stream, content)) {
+            ++lines;
+        }
+        REQUIRE(lines == 100);
+
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+    }
+
+    SECTION("Thread of the record, not of the background thread") {
+        const std::string logFileName = "log-async-thread";
+
+        rsm::LogPrefix prefix;
+        prefix.threadId = true;
+        auto device = std::make_unique<rsm::FileLogDevice>(logFileName);
+        device->setPrefix(prefix);
+        rsm::Logger::addLogDevice(std::move(device));
+        rsm::Logger::startAsync(16);
+
+        std::uint64_t otherId = 0;
+        rsm::Logger::info() << "Main";
+        std::thread other([&otherId]() {
+            otherId = rsm::detail::currentThreadId();
+            rsm::Logger::info() << "Other";
+        });
+        other.join();
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({
+            "[" + std::to_string(rsm::detail::currentThreadId()) + "][Info]Main",
+            "[" + std::to_string(otherId) + "][Info]Other"
+        }));
+    }
+
+    SECTION("Started and stopped while logging") {
+        const std::string logFileName = "log-async-toggled";
+        const int threadCount = 4;
+        const int recordCount = 2000;
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        std::atomic<int> finished(0);
+        std::vector<std::thread> threads;
+        for(int thread = 0; thread < threadCount; ++thread) {
+            threads.emplace_back([&]() {
+                for(int i = 0; i < recordCount; ++i) {
+                    rsm::Logger::info() << "Record";
+                }
+                ++finished;
+            });
+        }
+        while(finished < threadCount) {
+            rsm::Logger::startAsync(64);
+            rsm::Logger::stopAsync();
+        }
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName).size() == static_cast<std::size_t>(threadCount * recordCount));
+    }
+
+    SECTION("Device flushing, stopping and logging from the background thread") {
+        const std::size_t droppedBefore = rsm::Logger::getDroppedCount();
+        const auto device = std::make_shared<ReentrantLogDevice>();
+
+        rsm::Logger::addLogDevice(device);
+        rsm::Logger::startAsync(2);
+        rsm::Logger::info() << "Reentrant";
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(device->stopRefused);
+        REQUIRE(device->messages.front() == "Reentrant");
+        REQUIRE(device->messages.size() - 1 + rsm::Logger::getDroppedCount() - droppedBefore == 100);
+    }
+
+    SECTION("Records dropped when the queue is full") {
+        const std::string logFileName = "log-async-drop";
+        const std::size_t droppedBefore = rsm::Logger::getDroppedCount();
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        rsm::Logger::startAsync(2, rsm::LogOverflowPolicy::Drop);
+
+        const int count = 10000;
+        for(int i = 0; i < count; ++i) {
+            rsm::Logger::info() << i;
+        }
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+
+        std::ifstream stream;
+        stream.open(logFileName, std::ios::in);
+
+        REQUIRE(stream.is_open());
+        std::size_t lines = 0;
+        std::string content;
+        while(std::getline(stream, content)) {
+            ++lines;
+        }
+        REQUIRE(lines + rsm::Logger::getDroppedCount() - droppedBefore == count);
+    }
+
+}
+
+TEST_CASE("Deferred Logging", "[log]") {
+
+    SECTION("Formatted by a text device") {
+        const std::string logFileName = "log-deferred";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        const std::string name = "abc";
+        rsm::Logger::logDeferred(rsm::LogLevel::Info, "int {} uint {} double {} float {} bool {} char {} string {} {} class {}",
+                                 -42, 42u, 1.5, 0.1f, true, 'x', name, "literal", LoggingTestClass("streamed"));
+        rsm::Logger::logDeferred(rsm::LogLevel::Info, "bool {} {}", true, false);
+        rsm::Logger::info() << "bool " << true << ' ' << false;
+        rsm::Logger::logDeferred(rsm::LogLevel::Warning, "missing {} {}", 1);
+        rsm::Logger::logDeferred(rsm::LogLevel::Debug, "extra", 1);
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({
+            "[Info]int -42 uint 42 double 1.5 float 0.1 bool 1 char x string abc literal class streamed",
+            "[Info]bool 1 0",
+            "[Info]bool 1 0",
+            "[Warning]missing 1 {}",
+            "[Debug]extra" }));
+    }
+
+    SECTION("Signed and unsigned chars written as characters, as when streamed") {
+        const std::string logFileName = "log-deferred-chars";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        const std::int8_t small = 'A';
+        const std::uint8_t byte = 'B';
+        rsm::Logger::logDeferred(rsm::LogLevel::Info, "{}{}", small, byte);
+        rsm::Logger::info() << small << byte;
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]AB", "[Info]AB" }));
+    }
+
+    SECTION("Written and read back in binary form") {
+        const std::string logFileName = "log-binary";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::BinaryFileLogDevice>(logFileName));
+
+        for(int i = 0; i < 3; ++i) {
+            rsm::Logger::logDeferred(rsm::LogLevel::Error, "record {} of {}", i, 3);
+        }
+        rsm::Logger::info() << "text";
+        rsm::Logger::logDeferred(rsm::LogLevel::Debug, "other {}", 0.25);
+        rsm::Logger::resetLogDevices();
+
+        rsm::BinaryLogReader reader(logFileName);
+        std::vector<std::string> lines;
+        rsm::LogLevel level;
+        std::string message;
+        while(reader.next(level, message)) {
+            lines.push_back(rsm::logLevelToString(level) + ":" + message);
+        }
+        REQUIRE(lines == std::vector<std::string>({
+            "Error:record 0 of 3",
+            "Error:record 1 of 3",
+            "Error:record 2 of 3",
+            "Info:text",
+            "Debug:other 0.25" }));
+    }
+
+    SECTION("Formatted by the background thread") {
+        const std::string logFileName = "log-deferred-async";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        rsm::Logger::startAsync();
+
+        for(int i = 0; i < 100; ++i) {
+            rsm::Logger::logDeferred(rsm::LogLevel::Info, "record {}", i);
+        }
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == 100);
+        REQUIRE(lines.back() == "[Info]record 99");
+    }
+
+    SECTION("Not a binary log file") {
+        const std::string logFileName = "log-not-binary";
+
+        std::ofstream(logFileName) << "[Info]text\n";
+
+        REQUIRE_THROWS_AS(rsm::BinaryLogReader{ logFileName }, std::runtime_error);
+    }
+
+}
+
+TEST_CASE("Buffered File Log Device", "[log]") {
+
+    rsm::LogFlushPolicy policy;
+    policy.interval = std::chrono::milliseconds(0);
+
+    SECTION("Written on flush and destruction") {
+        const std::string logFileName = "log-buffered";
+
+        {
+            rsm::BufferedFileLogDevice device(logFileName, policy);
+            device.log(rsm::LogLevel::Info, "First");
+            REQUIRE(readLines(logFileName).empty());
+
+            device.flush();
+            REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]First" }));
+
+            device.log(rsm::LogLevel::Info, "Second");
+        }
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]First", "[Info]Second" }));
+    }
+
+    SECTION("Written on error level") {
+        const std::string logFileName = "log-buffered-error";
+
+        rsm::BufferedFileLogDevice device(logFileName, policy);
+        device.log(rsm::LogLevel::Warning, "Warning");
+        REQUIRE(readLines(logFileName).empty());
+
+        device.log(rsm::LogLevel::Error, "Error");
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Warning]Warning", "[Error]Error" }));
+    }
+
+    SECTION("Written when the buffer is full") {
+        const std::string logFileName = "log-buffered-full";
+        policy.bufferSize = 64;
+        policy.sync = true;
+
+        rsm::BufferedFileLogDevice device(logFileName, policy);
+        for(int i = 0; i < 10; ++i) {
+            device.log(rsm::LogLevel::Info, "Record " + std::to_string(i));
+        }
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() >= 5);
+        REQUIRE(lines.size() < 10);
+        REQUIRE(lines.front() == "[Info]Record 0");
+    }
+
+    SECTION("Written after the interval") {
+        const std::string logFileName = "log-buffered-interval";
+        policy.interval = std::chrono::milliseconds(10);
+
+        rsm::BufferedFileLogDevice device(logFileName, policy);
+        device.log(rsm::LogLevel::Info, "First");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        device.log(rsm::LogLevel::Info, "Second");
+        for(int i = 0; i < 500 && readLines(logFileName).size() < 2; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        REQUIRE(readLines(logFileName).size() == 2);
+    }
+
+    SECTION("Written after the interval without another record") {
+        const std::string logFileName = "log-buffered-timer";
+        policy.interval = std::chrono::milliseconds(10);
+
+        rsm::BufferedFileLogDevice device(logFileName, policy);
+        device.log(rsm::LogLevel::Info, "Only");
+        for(int i = 0; i < 500 && readLines(logFileName).empty(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Only" }));
+    }
+
+}
+
+TEST_CASE("Log Rotation", "[log]") {
+
+    rsm::LogRotationPolicy rotation;
+    rotation.maxSize = 40;
+    rotation.retainedFiles = 2;
+
+    SECTION("Appending to an existing file") {
+        const std::string logFileName = "log-append";
+
+        {
+            rsm::FileLogDevice device(logFileName);
+            device.log(rsm::LogLevel::Info, "Before restart");
+        }
+        {
+            rsm::FileLogDevice device(logFileName, rsm::LogFileMode::Append);
+            device.log(rsm::LogLevel::Info, "After restart");
+        }
+        {
+            rsm::BufferedFileLogDevice device(logFileName, rsm::LogFlushPolicy(), rsm::LogFileMode::Append);
+            device.log(rsm::LogLevel::Info, "Buffered");
+        }
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Before restart", "[Info]After restart", "[Info]Buffered" }));
+    }
+
+    SECTION("Rotating by size") {
+        const std::string logFileName = "log-rotate";
+        std::remove((logFileName + ".3").c_str());
+
+        {
+            rsm::FileLogDevice device(logFileName, rsm::LogFileMode::Truncate, rotation);
+            for(int i = 0; i < 10; ++i) {
+                // 20 bytes per line, so two lines per file
+                device.log(rsm::LogLevel::Info, "Record number " + std::to_string(i));
+            }
+        }
+
+        REQUIRE(readLines(logFileName).empty());
+        REQUIRE(readLines(logFileName + ".1") == std::vector<std::string>({ "[Info]Record number 8", "[Info]Record number 9" }));
+        REQUIRE(readLines(logFileName + ".2") == std::vector<std::string>({ "[Info]Record number 6", "[Info]Record number 7" }));
+        REQUIRE_FALSE(std::ifstream(logFileName + ".3").is_open());
+    }
+
+    SECTION("Rotating an appended file by size") {
+        const std::string logFileName = "log-rotate-append";
+
+        std::ofstream(logFileName) << std::string(39, 'x') << "\n";
+        {
+            rsm::FileLogDevice device(logFileName, rsm::LogFileMode::Append, rotation);
+            device.log(rsm::LogLevel::Info, "Record");
+        }
+
+        REQUIRE(readLines(logFileName).empty());
+        REQUIRE(readLines(logFileName + ".1").size() == 2);
+    }
+
+    SECTION("Rotating batches of the buffered device") {
+        const std::string logFileName = "log-rotate-buffered";
+        rsm::LogFlushPolicy policy;
+        policy.interval = std::chrono::milliseconds(0);
+
+        {
+            rsm::BufferedFileLogDevice device(logFileName, policy, rsm::LogFileMode::Truncate, rotation);
+            device.log(rsm::LogLevel::Info, "Record number 0");
+            device.log(rsm::LogLevel::Info, "Record number 1");
+            device.log(rsm::LogLevel::Info, "Record number 2");
+            device.flush();
+            device.log(rsm::LogLevel::Info, "Record number 3");
+        }
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Record number 3" }));
+        REQUIRE(readLines(logFileName + ".1").size() == 3);
+    }
+
+    SECTION("Rotating by time") {
+        const std::string logFileName = "log-rotate-time";
+        rsm::LogRotationPolicy timeRotation;
+        timeRotation.interval = std::chrono::milliseconds(10);
+
+        {
+            rsm::FileLogDevice device(logFileName, rsm::LogFileMode::Truncate, timeRotation);
+            device.log(rsm::LogLevel::Info, "Before");
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            device.log(rsm::LogLevel::Info, "Rotated with this one");
+            device.log(rsm::LogLevel::Info, "After");
+        }
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]After" }));
+        REQUIRE(readLines(logFileName + ".1") == std::vector<std::string>({ "[Info]Before", "[Info]Rotated with this one" }));
+    }
+
+}
+
+TEST_CASE("Mapped File Log Device", "[log]") {
+
+    const auto readMapped = [](const std::string& fileName) {
+        rsm::MappedLogReader reader(fileName);
+        std::vector<std::string> lines;
+        rsm::LogLevel level;
+        std::string message;
+        while(reader.next(level, message)) {
+            lines.push_back(rsm::logLevelToString(level) + ":" + message);
+        }
+        return lines;
+    };
+
+    SECTION("Growing by chunks") {
+        const std::string logFileName = "log-mapped";
+        const int count = 1000;
+
+        {
+            rsm::MappedFileLogDevice device(logFileName, 4096);
+            device.log(rsm::LogLevel::Info, "");
+            for(int i = 0; i < count; ++i) {
+                device.log(rsm::LogLevel::Debug, "Record " + std::to_string(i));
+            }
+            device.log(rsm::LogLevel::Error, std::string(10000, 'x'));
+        }
+
+        const auto lines = readMapped(logFileName);
+        REQUIRE(lines.size() == count + 2);
+        REQUIRE(lines.front() == "Info:");
+        REQUIRE(lines[count] == "Debug:Record 999");
+        REQUIRE(lines.back() == "Error:" + std::string(10000, 'x'));
+    }
+
+    SECTION("Readable while the device is alive") {
+        const std::string logFileName = "log-mapped-alive";
+
+        rsm::MappedFileLogDevice device(logFileName, 4096);
+        device.log(rsm::LogLevel::Warning, "Before a crash");
+
+        REQUIRE(readMapped(logFileName) == std::vector<std::string>({ "Warning:Before a crash" }));
+    }
+
+    SECTION("Stopping at a torn record") {
+        const std::string logFileName = "log-mapped-torn";
+
+        {
+            rsm::MappedFileLogDevice device(logFileName, 4096);
+            device.log(rsm::LogLevel::Info, "Complete");
+            device.log(rsm::LogLevel::Info, "Torn");
+        }
+        {
+            // Corrupts the last byte of the second message
+            std::fstream file(logFileName, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(8 + 12 + 8 + 12 + 3);
+            file.put('X');
+        }
+
+        REQUIRE(readMapped(logFileName) == std::vector<std::string>({ "Info:Complete" }));
+    }
+
+}
+
+TEST_CASE("Structured Logging", "[log]") {
+
+    SECTION("Fields appended by text devices") {
+        const std::string logFileName = "log-fields";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        rsm::Logger::info().kv("latency_us", 42).kv("host", "db-1") << "Request " << "done";
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Request done latency_us=42 host=\"db-1\"" }));
+    }
+
+    SECTION("String fields escaped by text devices") {
+        const std::string logFileName = "log-fields-escaped";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+
+        rsm::Logger::info().kv("path", "C:\\tmp \"x\"").kv("text", "Line\nbreak\x01") << "Escaped";
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Escaped path=\"C:\\\\tmp \\\"x\\\"\" text=\"Line\\nbreak\\u0001\"" }));
+    }
+
+    SECTION("JSON lines") {
+        const std::string logFileName = "log-json";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::StructuredFileLogDevice>(logFileName));
+
+        rsm::Logger::warning().kv("count", 3u).kv("ratio", 0.5).kv("ok", false).kv("path", "C:\\tmp \"x\"") << "Line\nbreak";
+        rsm::Logger::error() << "No field";
+        rsm::Logger::resetLogDevices();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == 2);
+        INFO(lines[0]);
+        REQUIRE(lines[0].find("{\"timestamp_us\":") == 0);
+        REQUIRE(lines[0].find(",\"level\":\"Warning\",\"message\":\"Line\\nbreak\",\"count\":3,\"ratio\":0.5,\"ok\":false,\"path\":\"C:\\\\tmp \\\"x\\\"\"}") != std::string::npos);
+        REQUIRE(lines[1].find("\"level\":\"Error\",\"message\":\"No field\"}") != std::string::npos);
+    }
+
+    SECTION("Binary records") {
+        const std::string logFileName = "log-structured-binary";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::StructuredFileLogDevice>(logFileName, rsm::StructuredLogFormat::Binary));
+        rsm::Logger::startAsync();
+
+        rsm::Logger::info().kv("latency_us", -7).kv("host", std::string("db-1")) << "Done";
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+
+        std::ifstream stream(logFileName, std::ios::binary);
+        const std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        REQUIRE(content.compare(0, 8, "RSMSLOG1") == 0);
+
+        std::uint32_t size;
+        std::uint32_t messageSize;
+        std::memcpy(&size, content.data() + 8, 4);
+        REQUIRE(content.size() == 12 + size);
+        REQUIRE(content[12] == static_cast<char>(rsm::LogLevel::Info));
+        std::memcpy(&messageSize, content.data() + 21, 4);
+        REQUIRE(content.substr(25, messageSize) == "Done");
+
+        const std::size_t fieldsOffset = 25 + messageSize;
+        rsm::LogFields fields(content.data() + fieldsOffset, content.size() - fieldsOffset);
+        std::vector<std::string> keys;
+        fields.forEach([&](const rsm::LogField& field) {
+            keys.emplace_back(field.key, field.keySize);
+            if(keys.size() == 1) {
+                REQUIRE(field.value.type == rsm::detail::ArgumentType::Int);
+                REQUIRE(field.value.intValue == -7);
+            } else {
+                REQUIRE(std::string(field.value.text, field.value.textSize) == "db-1");
+            }
+        });
+        REQUIRE(keys == std::vector<std::string>({ "latency_us", "host" }));
+    }
+
+}
+
+TEST_CASE("Source Location", "[log]") {
+
+    rsm::LogPrefix prefix;
+    prefix.location = true;
+    prefix.function = true;
+
+    SECTION("Written in the prefix of the macros") {
+        const std::string logFileName = "log-location";
+
+        auto device = std::make_unique<rsm::FileLogDevice>(logFileName);
+        device->setPrefix(prefix);
+        rsm::Logger::addLogDevice(std::move(device));
+
+        const int line = logLocatedRecord();
+        rsm::Logger::info() << "Unknown";
+        RSM_LOG_DEFERRED(rsm::LogLevel::Error, "Deferred {}", 1); const int deferredLine = __LINE__;
+        rsm::Logger::resetLogDevices();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == 3);
+        REQUIRE(lines[0] == "[Warning][test_log.cpp:" + std::to_string(line) + "][logLocatedRecord]Located");
+        REQUIRE(lines[1] == "[Info]Unknown");
+        REQUIRE(lines[2].find("[Error][test_log.cpp:" + std::to_string(deferredLine) + "][") == 0);
+        REQUIRE(lines[2].find("]Deferred 1") != std::string::npos);
+    }
+
+    SECTION("Kept by the background thread") {
+        const std::string logFileName = "log-location-async";
+
+        auto device = std::make_unique<rsm::FileLogDevice>(logFileName);
+        device->setPrefix(prefix);
+        rsm::Logger::addLogDevice(std::move(device));
+        rsm::Logger::startAsync(16);
+
+        const int line = logLocatedRecord();
+        rsm::Logger::info() << "Unknown";
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({
+            "[Warning][test_log.cpp:" + std::to_string(line) + "][logLocatedRecord]Located",
+            "[Info]Unknown"
+        }));
+    }
+
+    SECTION("Statements of a category") {
+        const std::string logFileName = "log-location-category";
+
+        rsm::LogPrefix filePrefix;
+        filePrefix.location = true;
+        {
+            rsm::LogCategory network("network");
+            auto device = std::make_shared<rsm::FileLogDevice>(logFileName);
+            device->setPrefix(filePrefix);
+            network.addLogDevice(std::move(device));
+
+            RSM_LOG_TO(network, rsm::LogLevel::Info) << "Connected"; const int line = __LINE__;
+            network.resetLogDevices();
+
+            REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info][test_log.cpp:" + std::to_string(line) + "]Connected" }));
+        }
+    }
+
+    SECTION("JSON fields") {
+        const std::string logFileName = "log-location-json";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::StructuredFileLogDevice>(logFileName));
+
+        const int line = logLocatedRecord();
+        rsm::Logger::resetLogDevices();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == 1);
+        INFO(lines[0]);
+        REQUIRE(lines[0].find("test_log.cpp\",\"line\":" + std::to_string(line) + ",\"function\":\"logLocatedRecord\",\"message\":\"Located\"}") != std::string::npos);
+    }
+
+}
+
+TEST_CASE("Memory Log Device", "[log]") {
+
+    SECTION("Records dumped on demand") {
+        const std::string logFileName = "log-memory";
+
+        auto device = std::make_unique<rsm::MemoryLogDevice>(logFileName);
+        auto& memoryDevice = *device;
+        rsm::Logger::addLogDevice(std::move(device));
+
+        rsm::Logger::debug() << "First";
+        rsm::Logger::info() << "Second";
+        REQUIRE(readLines(logFileName).empty());
+
+        memoryDevice.dump();
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Debug]First", "[Info]Second" }));
+
+        rsm::Logger::info() << "Third";
+        memoryDevice.dump();
+        memoryDevice.dump();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Debug]First", "[Info]Second", "[Info]Third" }));
+    }
+
+    SECTION("Records dumped by an error") {
+        const std::string logFileName = "log-memory-error";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::MemoryLogDevice>(logFileName));
+
+        rsm::Logger::debug() << "Context";
+        rsm::Logger::error() << "Failure";
+        rsm::Logger::debug() << "Not dumped";
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Debug]Context", "[Error]Failure" }));
+    }
+
+    SECTION("Only the last records kept") {
+        const std::string logFileName = "log-memory-ring";
+
+        rsm::MemoryLogPolicy policy;
+        policy.buffers = 1;
+        policy.records = 4;
+        policy.recordSize = 16;
+        rsm::MemoryLogDevice device(logFileName, policy);
+
+        for(int i = 0; i < 10; ++i) {
+            device.log(rsm::LogLevel::Info, "Record " + std::to_string(i));
+        }
+        device.log(rsm::LogLevel::Info, "A record longer than sixteen characters");
+        device.dump();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({
+            "[Info]Record 7", "[Info]Record 8", "[Info]Record 9", "[Info]A record "
+        }));
+    }
+
+    SECTION("Records of every thread merged in order") {
+        const std::string logFileName = "log-memory-threads";
+        const int threadCount = 4;
+        const int recordCount = 200;
+
+        rsm::MemoryLogPolicy policy;
+        policy.buffers = threadCount;
+        rsm::MemoryLogDevice device(logFileName, policy);
+
+        std::vector<std::thread> threads;
+        for(int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&device, t]() {
+                for(int i = 0; i < recordCount; ++i) {
+                    device.log(rsm::LogLevel::Info, std::to_string(t) + ' ' + std::to_string(i));
+                }
+            });
+        }
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        device.dump();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == threadCount * recordCount);
+        std::vector<int> nextRecord(threadCount, 0);
+        for(const auto& line : lines) {
+            const auto separator = line.find(' ');
+            const int thread = std::stoi(line.substr(6, separator - 6));
+            REQUIRE(std::stoi(line.substr(separator + 1)) == nextRecord[thread]++);
+        }
+    }
+
+    SECTION("Records of threads sharing a buffer never mixed") {
+        const std::string logFileName = "log-memory-shared";
+        const int threadCount = 8;
+
+        rsm::MemoryLogPolicy policy;
+        policy.buffers = 1;
+        policy.records = 4;
+        policy.recordSize = 64;
+        rsm::MemoryLogDevice device(logFileName, policy);
+
+        std::atomic<int> finished(0);
+        std::vector<std::thread> threads;
+        for(int t = 0; t < threadCount; ++t) {
+            threads.emplace_back([&device, &finished, t]() {
+                const std::string message(40, static_cast<char>('a' + t));
+                for(int i = 0; i < 20000; ++i) {
+                    device.log(rsm::LogLevel::Info, message);
+                }
+                ++finished;
+            });
+        }
+        while(finished < threadCount) {
+            device.dump();
+        }
+        for(auto& thread : threads) {
+            thread.join();
+        }
+        device.dump();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(!lines.empty());
+        for(const auto& line : lines) {
+            INFO(line);
+            REQUIRE(line.size() == 46);
+            REQUIRE(line.compare(0, 6, "[Info]") == 0);
+            REQUIRE(line.find_first_not_of(line[6], 6) == std::string::npos);
+        }
+    }
+
+    SECTION("Records logged during a dump written by the next one") {
+        const std::string logFileName = "log-memory-concurrent-dump";
+        const int recordCount = 20000;
+
+        rsm::MemoryLogPolicy policy;
+        policy.buffers = 1;
+        policy.records = 32768;
+        policy.recordSize = 32;
+        rsm::MemoryLogDevice device(logFileName, policy);
+
+        std::atomic<bool> logging(true);
+        std::thread dumper([&device, &logging]() {
+            while(logging) {
+                device.dump();
+            }
+        });
+        for(int i = 0; i < recordCount; ++i) {
+            device.log(rsm::LogLevel::Debug, std::to_string(i));
+        }
+        logging = false;
+        dumper.join();
+        device.dump();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == static_cast<std::size_t>(recordCount));
+        bool ordered = true;
+        for(int i = 0; i < recordCount; ++i) {
+            ordered = ordered && lines[static_cast<std::size_t>(i)] == "[Debug]" + std::to_string(i);
+        }
+        REQUIRE(ordered);
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    SECTION("Records dumped on a fatal signal") {
+        const std::string logFileName = "log-memory-signal";
+
+        const pid_t child = fork();
+        if(child == 0) {
+            rsm::MemoryLogDevice device(logFileName);
+            device.dumpOnFatalSignals();
+            device.log(rsm::LogLevel::Debug, "Before the crash");
+            std::abort();
+        }
+
+        int status = 0;
+        REQUIRE(waitpid(child, &status, 0) == child);
+        REQUIRE(WIFSIGNALED(status));
+        REQUIRE(WTERMSIG(status) == SIGABRT);
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Debug]Before the crash" }));
+    }
+#endif
+
+}
+
+TEST_CASE("Log Categories", "[log]") {
+
+    SECTION("Own level and devices") {
+        const std::string loggerFileName = "log-category-logger";
+        const std::string categoryFileName = "log-category";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(loggerFileName));
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::Error);
+        {
+            rsm::LogCategory network("network");
+            REQUIRE(network.getName() == "network");
+            network.addLogDevice(std::make_shared<rsm::FileLogDevice>(categoryFileName));
+            network.setLogLevelThreshold(rsm::LogLevel::Info);
+
+            network.debug() << "Debug";
+            network.info() << "Info";
+            network.logDeferred(rsm::LogLevel::Warning, "Sent {} bytes", 12);
+            rsm::Logger::warning() << "Filtered";
+            rsm::Logger::error() << "Logger";
+        }
+        rsm::Logger::setLogLevelThreshold(rsm::LogLevel::None);
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(categoryFileName) == std::vector<std::string>({ "[Info]Info", "[Warning]Sent 12 bytes" }));
+        REQUIRE(readLines(loggerFileName) == std::vector<std::string>({ "[Error]Logger" }));
+    }
+
+    SECTION("Devices of the Logger used without own devices") {
+        const std::string logFileName = "log-category-inherited";
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::FileLogDevice>(logFileName));
+        rsm::LogCategory& storage = rsm::LogCategory::get("storage");
+        REQUIRE(&storage == &rsm::LogCategory::get("storage"));
+        storage.setLogLevelThreshold(rsm::LogLevel::Warning);
+        evaluations = 0;
+
+        RSM_LOG_TO(storage, rsm::LogLevel::Info) << evaluated(1);
+        RSM_LOG_TO(storage, rsm::LogLevel::Error) << evaluated(2);
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(evaluations == 1);
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Error]2" }));
+    }
+
+    SECTION("Shared devices with the asynchronous logger") {
+        const std::string logFileName = "log-category-shared";
+
+        auto device = std::make_shared<rsm::FileLogDevice>(logFileName);
+        rsm::Logger::addLogDevice(device);
+        rsm::Logger::startAsync();
+        {
+            rsm::LogCategory first("first");
+            rsm::LogCategory second("second");
+            first.addLogDevice(device);
+            second.addLogDevice(device);
+
+            first.info() << "First";
+            second.info() << "Second";
+            rsm::Logger::info() << "Logger";
+        }
+        rsm::Logger::stopAsync();
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]First", "[Info]Second", "[Info]Logger" }));
+    }
+
+    SECTION("Records queued for a destroyed category") {
+        const std::string logFileName = "log-category-destroyed";
+
+        rsm::Logger::startAsync();
+        {
+            rsm::LogCategory network("network");
+            network.addLogDevice(std::make_shared<rsm::FileLogDevice>(logFileName));
+            for(int i = 0; i < 100; ++i) {
+                network.info() << i;
+            }
+        }
+        rsm::Logger::stopAsync();
+
+        const auto lines = readLines(logFileName);
+        REQUIRE(lines.size() == 100);
+        REQUIRE(lines.back() == "[Info]99");
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    SECTION("Category at namespace scope") {
+        const std::string logFileName = "log-category-static";
+
+        const pid_t child = fork();
+        if(child == 0) {
+            staticCategory.addLogDevice(std::make_shared<rsm::FileLogDevice>(logFileName));
+            staticCategory.info() << "Hello";
+            rsm::Logger::startAsync();
+            staticCategory.info() << "Queued";
+            // The Logger and then the category are destroyed
+            std::exit(0);
+        }
+
+        int status = 0;
+        REQUIRE(waitpid(child, &status, 0) == child);
+        REQUIRE(WIFEXITED(status));
+        REQUIRE(WEXITSTATUS(status) == 0);
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Hello", "[Info]Queued" }));
+    }
+#endif
+
+}
+
+TEST_CASE("Compressed File Log Device", "[log]") {
+
+    SECTION("LZ4 blocks") {
+        std::vector<std::string> inputs = { "", "a", "abcdabcdabcd", std::string(1000, 'x') };
+        std::string mixed;
+        std::uint32_t seed = 1;
+        for(int i = 0; i < 5000; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            mixed += i % 3 == 0 ? static_cast<char>(seed >> 16) : "The quick brown fox "[i % 20];
+        }
+        inputs.push_back(mixed);
+
+        rsm::detail::Lz4Compressor compressor;
+        for(const auto& input : inputs) {
+            std::string compressed(rsm::detail::lz4::compressBound(input.size()), '\0');
+            compressed.resize(compressor.compress(input.data(), input.size(), &compressed[0]));
+            std::string output(input.size(), '\0');
+            REQUIRE(rsm::detail::lz4::decompress(compressed.data(), compressed.size(), &output[0], output.size()));
+            REQUIRE(output == input);
+            if(input.size() == 1000) {
+                REQUIRE(compressed.size() < 20);
+            }
+        }
+
+        const char malformed[] = { 0x1f, 'a', 0x05, 0x00 };
+        char output[32];
+        REQUIRE_FALSE(rsm::detail::lz4::decompress(malformed, sizeof(malformed), output, sizeof(output)));
+    }
+
+    SECTION("Lines read back from any block") {
+        const std::string logFileName = "log-compressed";
+        const int count = 2000;
+
+        rsm::Logger::addLogDevice(std::make_unique<rsm::CompressedFileLogDevice>(logFileName, 4096));
+        std::size_t rawSize = 0;
+        for(int i = 0; i < count; ++i) {
+            rsm::Logger::info() << "Request " << i << " served in " << i % 17 << " ms";
+            rawSize += 6 + 8 + std::to_string(i).size() + 11 + std::to_string(i % 17).size() + 4;
+        }
+        rsm::Logger::resetLogDevices();
+
+        std::ifstream file(logFileName, std::ios::binary | std::ios::ate);
+        REQUIRE(static_cast<std::size_t>(file.tellg()) < rawSize / 2);
+
+        rsm::CompressedLogReader reader(logFileName);
+        REQUIRE(reader.getBlockCount() > 1);
+        std::string line;
+        int read = 0;
+        bool intact = true;
+        while(reader.next(line)) {
+            intact = intact && line == "[Info]Request " + std::to_string(read) + " served in " + std::to_string(read % 17) + " ms";
+            ++read;
+        }
+        REQUIRE(intact);
+        REQUIRE(read == count);
+
+        const std::size_t lastBlock = reader.getBlockCount() - 1;
+        REQUIRE(reader.getBlockOffset(lastBlock) > reader.getBlockOffset(0));
+        reader.seek(lastBlock);
+        std::string last;
+        while(reader.next(line)) {
+            last = line;
+        }
+        REQUIRE(last == "[Info]Request 1999 served in 10 ms");
+    }
+
+    SECTION("Flushed and appended blocks") {
+        const std::string logFileName = "log-compressed-append";
+        {
+            rsm::CompressedFileLogDevice device(logFileName);
+            device.log(rsm::LogLevel::Info, "First");
+            device.flush();
+
+            rsm::CompressedLogReader reader(logFileName);
+            std::string line;
+            REQUIRE(reader.next(line));
+            REQUIRE(line == "[Info]First");
+            REQUIRE_FALSE(reader.next(line));
+        }
+        {
+            rsm::CompressedFileLogDevice device(logFileName, 64 * 1024, rsm::LogFileMode::Append);
+            device.log(rsm::LogLevel::Error, "Second");
+        }
+
+        rsm::CompressedLogReader reader(logFileName);
+        REQUIRE(reader.getBlockCount() == 2);
+        std::string line;
+        std::vector<std::string> lines;
+        while(reader.next(line)) {
+            lines.push_back(line);
+        }
+        REQUIRE(lines == std::vector<std::string>({ "[Info]First", "[Error]Second" }));
+    }
+
+    SECTION("Appended after a torn block") {
+        const std::string logFileName = "log-compressed-torn";
+        {
+            rsm::CompressedFileLogDevice device(logFileName);
+            device.log(rsm::LogLevel::Info, "Kept");
+            device.flush();
+            device.log(rsm::LogLevel::Info, "Torn by a crash");
+        }
+        std::ifstream file(logFileName, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        file.close();
+        content.resize(content.size() - 3);
+        std::ofstream(logFileName, std::ios::binary | std::ios::trunc) << content;
+        {
+            rsm::CompressedFileLogDevice device(logFileName, 64 * 1024, rsm::LogFileMode::Append);
+            device.log(rsm::LogLevel::Error, "Appended");
+        }
+
+        rsm::CompressedLogReader reader(logFileName);
+        REQUIRE(reader.getBlockCount() == 2);
+        std::string line;
+        std::vector<std::string> lines;
+        while(reader.next(line)) {
+            lines.push_back(line);
+        }
+        REQUIRE(lines == std::vector<std::string>({ "[Info]Kept", "[Error]Appended" }));
+    }
+
+    SECTION("Not appended to another file") {
+        const std::string logFileName = "log-compressed-other";
+        {
+            rsm::FileLogDevice device(logFileName);
+            device.log(rsm::LogLevel::Info, "Text");
+        }
+
+        REQUIRE_THROWS_AS(rsm::CompressedFileLogDevice(logFileName, 64 * 1024, rsm::LogFileMode::Append), std::runtime_error);
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]Text" }));
+    }
+
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("Console Log Device", "[log]") {
+    const std::string logFileName = "log-console";
+
+    // The standard error goes to a file while the device writes to it
+    std::fflush(stderr);
+    const int savedError = dup(STDERR_FILENO);
+    const int file = open(logFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(file, STDERR_FILENO);
+    close(file);
+    const auto restoreError = [savedError]() {
+        dup2(savedError, STDERR_FILENO);
+        close(savedError);
+    };
+
+    SECTION("Line buffered") {
+        rsm::ConsoleLogDevice device(rsm::ConsoleStream::Stderr);
+        device.log(rsm::LogLevel::Info, "First");
+        const auto afterFirst = readLines(logFileName);
+        device.log(rsm::LogLevel::Debug, "");
+        restoreError();
+
+        REQUIRE(afterFirst == std::vector<std::string>({ "[Info]First" }));
+        REQUIRE(readLines(logFileName) == std::vector<std::string>({ "[Info]First", "[Debug]" }));
+    }
+
+    SECTION("Batches") {
+        rsm::ConsoleLogPolicy policy;
+        policy.lineBuffered = false;
+        policy.batchSize = 3;
+        policy.interval = std::chrono::milliseconds(0);
+        rsm::ConsoleLogDevice device(rsm::ConsoleStream::Stderr, policy);
+
+        device.log(rsm::LogLevel::Info, "1");
+        device.log(rsm::LogLevel::Info, "2");
+        const auto beforeBatch = readLines(logFileName);
+        device.log(rsm::LogLevel::Info, "3");
+        const auto afterBatch = readLines(logFileName);
+        device.log(rsm::LogLevel::Info, "4");
+        device.log(rsm::LogLevel::Error, "5");
+        const auto afterError = readLines(logFileName);
+        device.log(rsm::LogLevel::Info, "6");
+        device.flush();
+        restoreError();
+
+        REQUIRE(beforeBatch.empty());
+        REQUIRE(afterBatch == std::vector<std::string>({ "[Info]1", "[Info]2", "[Info]3" }));
+        REQUIRE(afterError.size() == 5);
+        REQUIRE(readLines(logFileName).size() == 6);
+    }
+}
+#endif
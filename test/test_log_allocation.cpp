@@ -0,0 +1,237 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "catch.hpp"
+
+#include <rsm/log/logger.hpp>
+#include <rsm/log/file_log_device.hpp>
+#include <rsm/log/buffered_file_log_device.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <thread>
+
+namespace {
+
+    std::atomic<std::size_t> allocations{0};
+
+    void* allocate(std::size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if(void* pointer = std::malloc(size == 0 ? 1 : size)) {
+            return pointer;
+        }
+        throw std::bad_alloc();
+    }
+
+    template<class Function>
+    std::size_t countAllocations(Function&& function) {
+        const std::size_t before = allocations.load();
+        function();
+        return allocations.load() - before;
+    }
+
+    bool isDigits(const std::string& text, std::size_t position, std::size_t count) {
+        for(std::size_t i = position; i < position + count; ++i) {
+            if(i >= text.size() || text[i] < '0' || text[i] > '9') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+void* operator new(std::size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+static_assert(rsm::logLevelNameLength(rsm::LogLevel::Critical) == 8, "Level names are known at compile time");
+
+TEST_CASE("Log Prefix", "[log]") {
+
+    SECTION("Level names") {
+        REQUIRE(std::string(rsm::logLevelName(rsm::LogLevel::Warning)) == "Warning");
+        REQUIRE(rsm::logLevelToString(rsm::LogLevel::None) == "None");
+    }
+
+    SECTION("Source location") {
+        rsm::LogPrefix prefix;
+        prefix.location = true;
+        prefix.function = true;
+        rsm::LogPrefixFormatter formatter(prefix);
+
+        char buffer[rsm::LogPrefixFormatter::MaxSize];
+        const std::string unknown(buffer, formatter.format(buffer, rsm::LogLevel::Info));
+        REQUIRE(unknown == "[Info]");
+
+        const std::string longName(100, 'f');
+        const rsm::detail::RecordLocationScope scope(rsm::LogSourceLocation{ "src/net/socket.cpp", 42, longName.c_str() });
+        const std::string located(buffer, formatter.format(buffer, rsm::LogLevel::Info));
+        REQUIRE(located == "[Info][socket.cpp:42][" + std::string(rsm::LogPrefixFormatter::MaxNameSize, 'f') + "]");
+    }
+
+    SECTION("Every field") {
+        rsm::LogPrefix prefix;
+        prefix.time = true;
+        prefix.threadId = true;
+        rsm::LogPrefixFormatter formatter(prefix);
+
+        char buffer[rsm::LogPrefixFormatter::MaxSize];
+        const std::string text(buffer, formatter.format(buffer, rsm::LogLevel::Info));
+
+        // [2018-05-21 14:03:12.123456][12345][Info]
+        INFO(text);
+        REQUIRE(text.size() > 36);
+        REQUIRE(text[0] == '[');
+        REQUIRE(isDigits(text, 1, 4));
+        REQUIRE(text[5] == '-');
+        REQUIRE(text[11] == ' ');
+        REQUIRE(text[20] == '.');
+        REQUIRE(isDigits(text, 21, 6));
+        REQUIRE(text.substr(27, 2) == "][");
+        REQUIRE(text.substr(text.size() - 7) == "][Info]");
+    }
+
+}
+
+TEST_CASE("Log Clock", "[log]") {
+
+    const auto secondsFromNow = [](std::uint64_t timestamp) {
+        const auto difference = rsm::LogClock::toSystemTime(timestamp) - std::chrono::system_clock::now();
+        return std::abs(std::chrono::duration<double>(difference).count());
+    };
+
+    SECTION("Steady clock") {
+        if(!rsm::LogClock::isUsingTsc()) {
+            const std::uint64_t first = rsm::LogClock::now();
+            const std::uint64_t second = rsm::LogClock::now();
+
+            REQUIRE(second >= first);
+            REQUIRE(secondsFromNow(second) < 0.1);
+        }
+    }
+
+    SECTION("Time-stamp counter") {
+        if(rsm::LogClock::useTsc()) {
+            REQUIRE(rsm::LogClock::isUsingTsc());
+
+            const std::uint64_t first = rsm::LogClock::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            const std::uint64_t second = rsm::LogClock::now();
+
+            REQUIRE(second > first);
+            REQUIRE(secondsFromNow(second) < 0.1);
+            const auto elapsed = rsm::LogClock::toSystemTime(second) - rsm::LogClock::toSystemTime(first);
+            REQUIRE(elapsed >= std::chrono::milliseconds(15));
+            REQUIRE(elapsed < std::chrono::milliseconds(500));
+        }
+    }
+
+    SECTION("Time of the record, not of the write") {
+        rsm::LogPrefix prefix;
+        prefix.time = true;
+        prefix.level = false;
+        rsm::LogPrefixFormatter formatter(prefix);
+
+        const std::uint64_t loggedAt = rsm::LogClock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        char buffer[rsm::LogPrefixFormatter::MaxSize];
+        std::string recordTime;
+        {
+            const rsm::detail::RecordTimestampScope scope(loggedAt);
+            recordTime.assign(buffer, formatter.format(buffer, rsm::LogLevel::Info));
+        }
+        const std::string writeTime(buffer, formatter.format(buffer, rsm::LogLevel::Info));
+
+        // Same format, 20 milliseconds apart
+        REQUIRE(recordTime.size() == writeTime.size());
+        REQUIRE(recordTime < writeTime);
+    }
+
+}
+
+TEST_CASE("Log Allocations", "[log]") {
+
+    SECTION("No allocation per line once warm") {
+        const std::string logFileName = "log-allocations";
+        const std::string bufferedFileName = "log-allocations-buffered";
+
+        rsm::LogPrefix prefix;
+        prefix.time = true;
+        prefix.threadId = true;
+        prefix.location = true;
+        prefix.function = true;
+        auto fileDevice = std::make_unique<rsm::FileLogDevice>(logFileName);
+        fileDevice->setPrefix(prefix);
+        auto bufferedDevice = std::make_unique<rsm::BufferedFileLogDevice>(bufferedFileName);
+        bufferedDevice->setPrefix(prefix);
+        rsm::Logger::addLogDevice(std::move(fileDevice));
+        rsm::Logger::addLogDevice(std::move(bufferedDevice));
+
+        const auto logLines = [](int count) {
+            for(int i = 0; i < count; ++i) {
+                rsm::Logger::info() << "Record " << i << ' ' << 1.5;
+                rsm::Logger::log(rsm::LogLevel::Warning, i);
+                RSM_LOG_INFO << "Located " << i;
+            }
+        };
+        logLines(100);
+        const std::size_t count = countAllocations([&]() {
+            logLines(1000);
+        });
+        rsm::Logger::resetLogDevices();
+
+        REQUIRE(count == 0);
+
+        std::ifstream stream(logFileName);
+        std::string content;
+        std::getline(stream, content);
+        REQUIRE(content.find("][Info]Record 0 1.5") != std::string::npos);
+    }
+
+}
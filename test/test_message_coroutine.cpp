@@ -0,0 +1,170 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "catch.hpp"
+
+#include <rsm/msg/message.hpp>
+#include <rsm/msg/message_handler.hpp>
+#include <rsm/msg/message_dispatcher.hpp>
+#include <rsm/msg/async_message_dispatcher.hpp>
+
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef RSM_HAS_COROUTINE
+
+namespace {
+
+    class AckHandler
+        : public rsm::MessageHandler {
+    public:
+        AckHandler(rsm::MessageDispatcher& dispatcher)
+            : m_dispatcher(dispatcher) {}
+
+        virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+            m_dispatcher.pushMessage("ack", message.getContent().get<int>() + 1);
+        }
+
+    private:
+        rsm::MessageDispatcher& m_dispatcher;
+    };
+
+    class RecordingHandler
+        : public rsm::MessageHandler {
+    public:
+        virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+            values.push_back(message.getContent().get<int>());
+        }
+
+        std::vector<int> values;
+    };
+
+    rsm::MessageTask requestAck(rsm::MessageDispatcher& dispatcher, int& result) {
+        dispatcher.pushMessage("request", 41);
+        const rsm::Message& ack = co_await rsm::nextMessage(dispatcher, "ack");
+        result = ack.getContent().get<int>();
+    }
+
+    rsm::MessageTask waitTwice(rsm::MessageDispatcher& dispatcher, std::vector<int>& results) {
+        results.push_back((co_await rsm::nextMessage(dispatcher, "value")).getContent().get<int>());
+        results.push_back((co_await rsm::nextMessage(dispatcher, "value")).getContent().get<int>());
+    }
+
+    rsm::MessageTask pushMany(rsm::MessageDispatcher& dispatcher, int count, int& pushed) {
+        for(int i = 0; i < count; ++i) {
+            co_await rsm::pushMessageAsync(dispatcher, "value", i);
+            ++pushed;
+        }
+    }
+
+    rsm::MessageTask waitAsync(rsm::AsyncMessageDispatcher& dispatcher, std::promise<std::thread::id>& resumedOn) {
+        co_await rsm::nextMessage(dispatcher, "ack");
+        resumedOn.set_value(std::this_thread::get_id());
+    }
+
+}
+
+TEST_CASE("Testing Message Dispatcher Coroutines", "[msg_dispatcher]") {
+
+    SECTION("Waiting for a reply") {
+        rsm::MessageDispatcher dispatcher;
+        AckHandler handler(dispatcher);
+        dispatcher.registerHandler("request", handler);
+
+        int result = 0;
+        requestAck(dispatcher, result);
+        REQUIRE(result == 0);
+
+        dispatcher.dispatch();
+        REQUIRE(result == 42);
+    }
+
+    SECTION("Waiting again receives the next message only") {
+        rsm::MessageDispatcher dispatcher;
+
+        std::vector<int> results;
+        waitTwice(dispatcher, results);
+
+        dispatcher.pushMessage("value", 1);
+        dispatcher.pushMessage("other", 2);
+        dispatcher.pushMessage("value", 3);
+        dispatcher.dispatch();
+
+        REQUIRE(results == std::vector<int>({ 1, 3 }));
+    }
+
+    SECTION("Pushing under backpressure") {
+        rsm::MessageDispatcher dispatcher;
+        RecordingHandler handler;
+        dispatcher.registerHandler("value", handler);
+        dispatcher.setCapacity(2);
+
+        int pushed = 0;
+        pushMany(dispatcher, 5, pushed);
+        REQUIRE(pushed == 2);
+
+        dispatcher.dispatch();
+        REQUIRE(pushed == 5);
+        REQUIRE(handler.values == std::vector<int>({ 0, 1, 2, 3, 4 }));
+    }
+
+    SECTION("Suspended pushers resumed once the capacity is unlimited") {
+        rsm::MessageDispatcher dispatcher;
+        RecordingHandler handler;
+        dispatcher.registerHandler("value", handler);
+        dispatcher.setCapacity(1);
+
+        int pushed = 0;
+        pushMany(dispatcher, 5, pushed);
+        REQUIRE(pushed == 1);
+
+        dispatcher.setCapacity(0);
+        dispatcher.dispatch();
+        REQUIRE(pushed == 5);
+        REQUIRE(handler.values == std::vector<int>({ 0, 1, 2, 3, 4 }));
+    }
+
+}
+
+TEST_CASE("Testing Async Message Dispatcher Coroutines", "[async_msg_dispatcher]") {
+
+    SECTION("Resuming on the dispatching thread") {
+        rsm::AsyncMessageDispatcher dispatcher;
+
+        std::promise<std::thread::id> resumedOn;
+        auto future = resumedOn.get_future();
+        waitAsync(dispatcher, resumedOn);
+
+        dispatcher.startDispatching();
+        dispatcher.pushMessage("ack");
+
+        REQUIRE(future.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        REQUIRE(future.get() != std::this_thread::get_id());
+
+        dispatcher.stopDispatching();
+    }
+
+}
+
+#endif
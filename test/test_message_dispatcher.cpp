@@ -26,6 +26,14 @@
 #include <rsm/msg/message_handler.hpp>
 #include <rsm/msg/message_dispatcher.hpp>
 #include <rsm/msg/async_message_dispatcher.hpp>
+#include <rsm/msg/executor.hpp>
+#include <rsm/msg/worker_executor.hpp>
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 class Handler
     : public rsm::MessageHandler {
@@ -42,6 +50,93 @@ public:
 
 };
 
+template<class Dispatcher>
+class ReplyHandler
+    : public rsm::MessageHandler {
+public:
+    ReplyHandler(Dispatcher& dispatcher)
+        : m_dispatcher(dispatcher) {}
+
+    virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+        m_dispatcher.reply(message, message.getContent().get<int>() * 2);
+    }
+
+private:
+    Dispatcher& m_dispatcher;
+};
+
+class ThreadHandler
+    : public rsm::MessageHandler {
+public:
+    virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+        m_thread.set_value(std::this_thread::get_id());
+    }
+
+    std::future<std::thread::id> getThread() {
+        return m_thread.get_future();
+    }
+
+private:
+    std::promise<std::thread::id> m_thread;
+};
+
+class OrderHandler
+    : public rsm::MessageHandler {
+public:
+    virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+        ordered = ordered && message.getContent().get<int>() == count;
+        ++count;
+    }
+
+    int count = 0;
+    bool ordered = true;
+};
+
+class QuitHandler
+    : public rsm::MessageHandler {
+public:
+    QuitHandler(rsm::AsyncMessageDispatcher& dispatcher)
+        : m_dispatcher(dispatcher) {}
+
+    virtual void onMessage(const std::string& key, const rsm::Message& message) override {
+        m_dispatcher.stopDispatching();
+        m_stopped.set_value();
+    }
+
+    std::future<void> getStopped() {
+        return m_stopped.get_future();
+    }
+
+private:
+    rsm::AsyncMessageDispatcher& m_dispatcher;
+    std::promise<void> m_stopped;
+};
+
+class ManualExecutor
+    : public rsm::Executor {
+public:
+    virtual void execute(std::function<void()> task) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back(std::move(task));
+    }
+
+    std::size_t run() {
+        std::vector<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            tasks.swap(m_tasks);
+        }
+        for(auto& task : tasks) {
+            task();
+        }
+        return tasks.size();
+    }
+
+private:
+    std::vector<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+};
+
 TEST_CASE("Testing Message Dispatcher", "[msg_dispatcher]") {
 
     SECTION("Dispatching an empty message") {
@@ -68,6 +163,38 @@ TEST_CASE("Testing Message Dispatcher", "[msg_dispatcher]") {
         dispatcher.dispatch();
     }
 
+    SECTION("Request and reply") {
+        rsm::MessageDispatcher dispatcher;
+
+        ReplyHandler<rsm::MessageDispatcher> handler(dispatcher);
+        dispatcher.registerHandler("double", handler);
+
+        auto future = dispatcher.request("double", 21);
+        REQUIRE(future.wait_for(std::chrono::seconds(0)) == std::future_status::timeout);
+
+        dispatcher.dispatch();
+
+        REQUIRE(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+        REQUIRE(future.get().getContent().get<int>() == 42);
+    }
+
+    SECTION("Request timing out") {
+        rsm::MessageDispatcher dispatcher;
+
+        auto future = dispatcher.request("nobody", 21, std::chrono::milliseconds(0));
+        dispatcher.dispatch();
+
+        REQUIRE_THROWS_AS(future.get(), std::runtime_error);
+    }
+
+    SECTION("Too many pending requests") {
+        rsm::MessageDispatcher dispatcher;
+        dispatcher.setMaxPendingRequests(1);
+
+        auto future = dispatcher.request("nobody", 21);
+        REQUIRE_THROWS_AS(dispatcher.request("nobody", 21), std::runtime_error);
+    }
+
 }
 
 TEST_CASE("Testing Async Message Dispatcher", "[async_msg_dispatcher]") {
@@ -100,4 +227,115 @@ TEST_CASE("Testing Async Message Dispatcher", "[async_msg_dispatcher]") {
         dispatcher.stopDispatching();
     }
 
+    SECTION("Request and reply") {
+        rsm::AsyncMessageDispatcher dispatcher;
+
+        ReplyHandler<rsm::AsyncMessageDispatcher> handler(dispatcher);
+        dispatcher.registerHandler("double", handler);
+
+        dispatcher.startDispatching();
+
+        auto future = dispatcher.request("double", 21, std::chrono::seconds(5));
+        REQUIRE(future.get().getContent().get<int>() == 42);
+
+        dispatcher.stopDispatching();
+    }
+
+    SECTION("Request timing out") {
+        rsm::AsyncMessageDispatcher dispatcher;
+
+        dispatcher.startDispatching();
+
+        auto future = dispatcher.request("nobody", 21, std::chrono::milliseconds(10));
+        REQUIRE(future.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        REQUIRE_THROWS_AS(future.get(), std::runtime_error);
+
+        dispatcher.stopDispatching();
+    }
+
+    SECTION("Handlers on the dispatching thread and on a worker") {
+        rsm::AsyncMessageDispatcher dispatcher;
+        dispatcher.addWorker("worker", 0);
+
+        ThreadHandler dispatchingHandler;
+        ThreadHandler workerHandler;
+        dispatcher.registerHandler("thread", dispatchingHandler);
+        dispatcher.registerHandler("thread", workerHandler, "worker");
+
+        dispatcher.startDispatching();
+        dispatcher.pushMessage("thread");
+
+        auto dispatchingThread = dispatchingHandler.getThread();
+        auto workerThread = workerHandler.getThread();
+        REQUIRE(dispatchingThread.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        REQUIRE(workerThread.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+
+        const auto dispatchingId = dispatchingThread.get();
+        const auto workerId = workerThread.get();
+        REQUIRE(dispatchingId != std::this_thread::get_id());
+        REQUIRE(workerId != std::this_thread::get_id());
+        REQUIRE(workerId != dispatchingId);
+
+        dispatcher.stopDispatching();
+    }
+
+    SECTION("Handler on a user executor") {
+        rsm::AsyncMessageDispatcher dispatcher;
+        ManualExecutor executor;
+
+        ThreadHandler handler;
+        dispatcher.registerHandler("thread", handler, executor);
+
+        dispatcher.startDispatching();
+        dispatcher.pushMessage("thread");
+        dispatcher.stopDispatching();
+
+        REQUIRE(executor.run() == 1);
+        REQUIRE(handler.getThread().get() == std::this_thread::get_id());
+    }
+
+    SECTION("Single producer") {
+        const int count = 100000;
+        rsm::AsyncMessageDispatcher dispatcher(rsm::AsyncMessageDispatcher::ProducerMode::Single, 64);
+
+        OrderHandler handler;
+        dispatcher.registerHandler("order", handler);
+
+        dispatcher.startDispatching();
+        for(int i = 0; i < count; ++i) {
+            dispatcher.pushMessage("order", i);
+        }
+        dispatcher.stopDispatching();
+
+        REQUIRE(handler.count == count);
+        REQUIRE(handler.ordered);
+    }
+
+    SECTION("Stopped from an handler") {
+        rsm::AsyncMessageDispatcher dispatcher;
+
+        QuitHandler quitHandler(dispatcher);
+        OrderHandler orderHandler;
+        dispatcher.registerHandler("quit", quitHandler);
+        dispatcher.registerHandler("order", orderHandler);
+
+        dispatcher.startDispatching();
+        dispatcher.pushMessage("quit");
+        REQUIRE(quitHandler.getStopped().wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+
+        // Joins the stopped thread and starts a new one
+        dispatcher.startDispatching();
+        dispatcher.pushMessage("order", 0);
+        dispatcher.stopDispatching();
+
+        REQUIRE(orderHandler.count == 1);
+    }
+
+    SECTION("Handler on an unknown worker") {
+        rsm::AsyncMessageDispatcher dispatcher;
+
+        ThreadHandler handler;
+        REQUIRE_THROWS_AS(dispatcher.registerHandler("thread", handler, "unknown"), std::runtime_error);
+    }
+
 }
@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "catch.hpp"
+
+#include <rsm/mpsc_ring_buffer.hpp>
+
+#include <thread>
+#include <vector>
+
+TEST_CASE("Testing MPSC Ring Buffer", "[mpsc_ring_buffer]") {
+
+    SECTION("Pushing until full") {
+        rsm::MpscRingBuffer<int> buffer(4);
+
+        for(int i = 0; i < 4; ++i) {
+            REQUIRE(buffer.tryPush([i](int& slot) { slot = i; }));
+        }
+        REQUIRE_FALSE(buffer.tryPush([](int& slot) { slot = 4; }));
+        REQUIRE(buffer.pushedCount() == 4);
+
+        std::vector<int> values;
+        REQUIRE(buffer.consume([&](int value) { values.push_back(value); }) == 4);
+        REQUIRE(values == std::vector<int>({ 0, 1, 2, 3 }));
+        REQUIRE(buffer.empty());
+        REQUIRE(buffer.consumedCount() == 4);
+        REQUIRE(buffer.tryPush([](int& slot) { slot = 4; }));
+    }
+
+    SECTION("Transferring from many threads") {
+        const int producerCount = 4;
+        const int count = 50000;
+        rsm::MpscRingBuffer<int> buffer(64);
+
+        std::vector<std::thread> producers;
+        for(int producer = 0; producer < producerCount; ++producer) {
+            producers.emplace_back([&buffer, producer]() {
+                for(int i = 0; i < count; ++i) {
+                    while(!buffer.tryPush([&](int& slot) { slot = producer * count + i; })) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        // Every producer's values must come out in the order it pushed them
+        std::vector<int> next(producerCount, 0);
+        bool ordered = true;
+        int received = 0;
+        while(received < producerCount * count) {
+            const auto consumed = buffer.consume([&](int value) {
+                const int producer = value / count;
+                ordered = ordered && value % count == next[producer];
+                ++next[producer];
+                ++received;
+            });
+            if(consumed == 0) {
+                std::this_thread::yield();
+            }
+        }
+        for(auto& producer : producers) {
+            producer.join();
+        }
+
+        REQUIRE(ordered);
+        REQUIRE(buffer.empty());
+    }
+
+}
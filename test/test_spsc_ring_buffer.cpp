@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "catch.hpp"
+
+#include <rsm/spsc_ring_buffer.hpp>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Testing SPSC Ring Buffer", "[spsc_ring_buffer]") {
+
+    SECTION("Capacity rounded to a power of two") {
+        rsm::SpscRingBuffer<int> buffer(5);
+
+        REQUIRE(buffer.capacity() == 8);
+    }
+
+    SECTION("Pushing until full") {
+        rsm::SpscRingBuffer<int> buffer(4);
+
+        for(int i = 0; i < 4; ++i) {
+            REQUIRE(buffer.tryPush(i));
+        }
+        REQUIRE_FALSE(buffer.tryPush(4));
+
+        std::vector<int> values;
+        REQUIRE(buffer.consume([&](int value) { values.push_back(value); }) == 4);
+        REQUIRE(values == std::vector<int>({ 0, 1, 2, 3 }));
+        REQUIRE(buffer.empty());
+        REQUIRE(buffer.tryPush(4));
+    }
+
+    SECTION("Wrapping around") {
+        rsm::SpscRingBuffer<int> buffer(4);
+
+        std::vector<int> values;
+        for(int i = 0; i < 10; ++i) {
+            REQUIRE(buffer.tryPush(i));
+            REQUIRE(buffer.tryPush(i + 100));
+            buffer.consume([&](int value) { values.push_back(value); });
+        }
+        REQUIRE(values.size() == 20);
+        REQUIRE(values[18] == 9);
+        REQUIRE(values[19] == 109);
+    }
+
+    SECTION("Destroying unconsumed elements") {
+        auto value = std::make_shared<int>(0);
+        {
+            rsm::SpscRingBuffer<std::shared_ptr<int>> buffer(4);
+            buffer.tryPush(value);
+            buffer.tryPush(value);
+            REQUIRE(value.use_count() == 3);
+        }
+        REQUIRE(value.use_count() == 1);
+    }
+
+    SECTION("Transferring between two threads") {
+        const int count = 100000;
+        rsm::SpscRingBuffer<int> buffer(64);
+
+        std::thread producer([&]() {
+            for(int i = 0; i < count; ++i) {
+                while(!buffer.tryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        int expected = 0;
+        bool ordered = true;
+        while(expected < count) {
+            const auto consumed = buffer.consume([&](int value) {
+                ordered = ordered && value == expected;
+                ++expected;
+            });
+            if(consumed == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        REQUIRE(ordered);
+        REQUIRE(buffer.empty());
+    }
+
+}
@@ -0,0 +1,50 @@
+/*
+* Copyright (c) 2018 Jean-Sébastien Fauteux
+*
+* This software is provided 'as-is', without any express or implied warranty.
+* In no event will the authors be held liable for any damages arising from
+* the use of this software.
+*
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it freely,
+* subject to the following restrictions:
+*
+* 1. The origin of this software must not be misrepresented; you must not claim
+*    that you wrote the original software. If you use this software in a product,
+*    an acknowledgment in the product documentation would be appreciated but is
+*    not required.
+*
+* 2. Altered source versions must be plainly marked as such, and must not be
+*    misrepresented as being the original software.
+*
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <rsm/log/binary_log_reader.hpp>
+
+#include <exception>
+#include <iostream>
+#include <string>
+
+// Prints the records of a binary log file as the text devices would
+int main(int argc, char** argv) {
+    if(argc != 2) {
+        std::cerr << "Usage: rsm_log_decode file\n"
+                  << "Prints the records of a file written by rsm::BinaryFileLogDevice\n";
+        return 1;
+    }
+
+    try {
+        rsm::BinaryLogReader reader(argv[1]);
+        rsm::LogLevel level;
+        std::string message;
+        while(reader.next(level, message)) {
+            std::cout << "[" << rsm::logLevelName(level) << "]" << message << "\n";
+        }
+    } catch(const std::exception& exception) {
+        std::cerr << argv[1] << ": " << exception.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}